@@ -1,8 +1,8 @@
 #!/usr/bin/sh
 
 CFLAGS="-Wall -O3"
-CLIBS="-lraylib -lm -lwinmm -lgdi32"
+CLIBS="-lraylib -lm -lwinmm -lgdi32 -lpthread"
 
 mkdir -p ./build
 
-x86_64-w64-mingw32-gcc $CFLAGS src/main.c -o ./build/snakegame.exe -L ./src/raylib-5.0_win64_mingw-w64/lib/ -I ./src/raylib-5.0_win64_mingw-w64/include/ $CLIBS
\ No newline at end of file
+x86_64-w64-mingw32-gcc $CFLAGS src/main.c src/tilemap.c src/sim.c src/path.c src/dstar.c src/hamilton.c src/bitgrid.c src/mcts.c src/observe.c src/neural.c src/solver.c src/level.c src/levelpack.c src/input.c src/triplebuffer.c src/snakebody.c src/clock.c -o ./build/snakegame.exe -L ./src/raylib-5.0_win64_mingw-w64/lib/ -I ./src/raylib-5.0_win64_mingw-w64/include/ $CLIBS
\ No newline at end of file
@@ -0,0 +1,685 @@
+/**
+ * Headless micro benchmarks for the simulation and AI code.
+ *
+ * Usage: ./build/bench [name]
+*/
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stddef.h"
+#include "time.h"
+#include "sim.h"
+#include "path.h"
+#include "dstar.h"
+#include "hamilton.h"
+#include "bitgrid.h"
+#include "mcts.h"
+#include "clock.h"
+#include "observe.h"
+#include "neural.h"
+#include "level.h"
+#include "snakebody.h"
+
+static double BenchNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Keeps the compiler from dropping copies whose result is never read
+static inline void BenchClobber(void) {
+    __asm__ volatile("" ::: "memory");
+}
+
+static SimTileMap* BenchCreateTileMap(int rows, int cols) {
+    TileMap tileMap = {.rows = rows, .cols = cols, .tileWidth = 1, .tileHeight = 1};
+    tileMap.tiles = (TileValue*) calloc(rows * cols, sizeof(TileValue));
+
+    SimTileMap *simTileMap = SimTileMapCreate(&tileMap);
+    free(tileMap.tiles);
+
+    return simTileMap;
+}
+
+// Grows a snake of the given length walking a serpentine path so it never hits itself
+static void BenchGrowSnake(SimState *state, int length) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int direction = SIM_RIGHT;
+
+    state->pendingGrowth = length - state->length;
+    state->hash = SimComputeHash(state);
+
+    while (state->length < length && !state->isOver) {
+        int col = state->head % tileMap->cols;
+
+        if ((direction == SIM_RIGHT && col == tileMap->cols - 1) || (direction == SIM_LEFT && col == 0)) {
+            SimStep(state, SIM_DOWN);
+            direction = direction == SIM_RIGHT ? SIM_LEFT : SIM_RIGHT;
+        } else {
+            SimStep(state, direction);
+        }
+    }
+}
+
+static void BenchFork(void) {
+    SimTileMap *tileMap = BenchCreateTileMap(20, 20);
+    SimState *root = (SimState*) malloc(sizeof(SimState));
+    SimState *fork = (SimState*) malloc(sizeof(SimState));
+    int lengths[] = {4, 64, 256};
+
+    for (int l = 0; l < 3; l++) {
+        TilePosition head = {.row = 0, .col = 0};
+        SimInit(root, tileMap, head, 1);
+        BenchGrowSnake(root, lengths[l]);
+
+        int iterations = 2000000;
+        double start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            SimFork(fork, root);
+            SimRelease(fork);
+        }
+
+        double forkTime = BenchNow() - start;
+
+        start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            memcpy(fork, root, sizeof(SimState));
+            BenchClobber();
+        }
+
+        double copyTime = BenchNow() - start;
+
+        start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            SimFork(fork, root);
+            SimStep(fork, (root->direction + 1) & 3);
+            SimRelease(fork);
+        }
+
+        double stepTime = BenchNow() - start;
+
+        printf("fork length=%d bytes=%zu forks/s=%.0f full-copy/s=%.0f fork+step/s=%.0f\n",
+            root->length,
+            offsetof(SimState, body) + sizeof(uint64_t) * ((root->length + 31) / 32),
+            iterations / forkTime,
+            iterations / copyTime,
+            iterations / stepTime);
+
+        SimRelease(root);
+    }
+
+    free(root);
+    free(fork);
+    SimTileMapRelease(tileMap);
+}
+
+static void BenchBfs(void) {
+    int sizes[] = {20, 64};
+
+    for (int s = 0; s < 2; s++) {
+        int size = sizes[s];
+        SimTileMap *tileMap = BenchCreateTileMap(size, size);
+        SimState *state = (SimState*) malloc(sizeof(SimState));
+        int *bodyCells = (int*) malloc(sizeof(int) * SIM_MAX_LENGTH);
+        PathFinder pathFinder;
+        TilePosition head = {.row = 0, .col = 0};
+
+        SimInit(state, tileMap, head, 1);
+        BenchGrowSnake(state, size * size / 4);
+        PathFinderInit(&pathFinder, size, size);
+
+        int length = SimGetBodyCells(state, bodyCells);
+        int goal = size * size - 1;
+        int iterations = 20000;
+        double worst = 0;
+        double start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            double planStart = BenchNow();
+
+            PathFinderClearObstacles(&pathFinder, &tileMap->tileMap);
+            PathFinderBlockSnake(&pathFinder, state->head, bodyCells, length, state->pendingGrowth);
+            PathFinderSearch(&pathFinder, state->head, &goal, 1);
+
+            double planTime = BenchNow() - planStart;
+            worst = planTime > worst ? planTime : worst;
+        }
+
+        double total = BenchNow() - start;
+
+        printf("bfs board=%dx%d length=%d path=%d avg=%.2fus worst=%.2fus\n",
+            size, size, length, pathFinder.pathLength, total / iterations * 1e6, worst * 1e6);
+
+        PathFinderFree(&pathFinder);
+        SimRelease(state);
+        SimTileMapRelease(tileMap);
+        free(bodyCells);
+        free(state);
+    }
+}
+
+// Follows the incremental plan on a 256x256 board and times a full BFS on the same states
+static void BenchDStar(void) {
+    int size = 256;
+    SimTileMap *tileMap = BenchCreateTileMap(size, size);
+    SimState *state = (SimState*) malloc(sizeof(SimState));
+    int *bodyCells = (int*) malloc(sizeof(int) * (SIM_MAX_LENGTH + 1));
+    PathFinder pathFinder;
+    DStarPlanner planner;
+    TilePosition head = {.row = 0, .col = 0};
+
+    SimInit(state, tileMap, head, 1);
+    BenchGrowSnake(state, SIM_MAX_LENGTH);
+    PathFinderInit(&pathFinder, size, size);
+    DStarInit(&planner, size, size);
+
+    // Far away from the head, behind the body
+    int goal = (size / 2) * size + size / 2;
+    int length = SimGetBodyCells(state, bodyCells);
+    bodyCells[length] = state->head;
+
+    double start = BenchNow();
+    DStarReset(&planner, &tileMap->tileMap, bodyCells, length + 1, state->head, goal);
+    int direction = DStarPlan(&planner);
+    double resetTime = BenchNow() - start;
+
+    double dstarTime = 0;
+    double bfsTime = 0;
+    long expanded = 0;
+    int ticks = 0;
+
+    while (direction >= 0 && state->head != goal && !state->isOver) {
+        int tailCell = state->length > 0 ? bodyCells[state->length - 1] : state->head;
+        int grows = state->pendingGrowth > 0;
+
+        SimStep(state, direction);
+        length = SimGetBodyCells(state, bodyCells);
+        ticks++;
+
+        start = BenchNow();
+        PathFinderClearObstacles(&pathFinder, &tileMap->tileMap);
+        PathFinderBlockSnake(&pathFinder, state->head, bodyCells, length, state->pendingGrowth);
+        PathFinderSearch(&pathFinder, state->head, &goal, 1);
+        bfsTime += BenchNow() - start;
+
+        start = BenchNow();
+        DStarSetOccupied(&planner, state->head, 1);
+
+        if (!grows) {
+            DStarSetOccupied(&planner, tailCell, -1);
+        }
+
+        DStarMoveStart(&planner, state->head);
+        direction = DStarPlan(&planner);
+        dstarTime += BenchNow() - start;
+        expanded += planner.expanded;
+    }
+
+    printf("dstar board=%dx%d length=%d ticks=%d initial=%.1fus repair=%.2fus expanded/tick=%.1f bfs=%.2fus\n",
+        size, size, state->length, ticks, resetTime * 1e6,
+        dstarTime / ticks * 1e6, (double) expanded / ticks, bfsTime / ticks * 1e6);
+
+    PathFinderFree(&pathFinder);
+    DStarFree(&planner);
+    SimRelease(state);
+    SimTileMapRelease(tileMap);
+    free(bodyCells);
+    free(state);
+}
+
+static void BenchHamilton(void) {
+    int size = 512;
+    TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+    HamiltonCycle cycle;
+    uint64_t rng = 1;
+
+    tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+
+    // Scattered 2x2 pillars so the cycle has to go around walls
+    for (int i = 0; i < size * size / 400; i++) {
+        int cell = SimRandom(&rng) % (size * size);
+        int topLeft = (cell / size / 2) * 2 * size + (cell % size / 2) * 2;
+
+        if (topLeft != 0) {
+            tileMap.tiles[topLeft] = TILE_WALL;
+            tileMap.tiles[topLeft + 1] = TILE_WALL;
+            tileMap.tiles[topLeft + size] = TILE_WALL;
+            tileMap.tiles[topLeft + size + 1] = TILE_WALL;
+        }
+    }
+
+    HamiltonInit(&cycle, size, size);
+
+    double start = BenchNow();
+    HamiltonBuild(&cycle, &tileMap, 0);
+    double buildTime = BenchNow() - start;
+
+    // Play on the cycle with shortcuts until the snake is a quarter of the board
+    SimTileMap *simTileMap = SimTileMapCreate(&tileMap);
+    SimState *state = (SimState*) malloc(sizeof(SimState));
+    int *bodyCells = (int*) malloc(sizeof(int) * SIM_MAX_LENGTH);
+    TilePosition head = {.row = 0, .col = 0};
+    double decideTime = 0;
+
+    SimInit(state, simTileMap, head, 1);
+
+    while (!state->isOver && state->ticks < 2000000 && state->length < SIM_MAX_LENGTH - 8) {
+        int length = SimGetBodyCells(state, bodyCells);
+        int tail = length > 0 ? bodyCells[length - 1] : state->head;
+
+        start = BenchNow();
+        int direction = HamiltonGetDirection(&cycle, state->head, tail, state->appleCell, length + 1);
+        decideTime += BenchNow() - start;
+
+        SimStep(state, direction);
+    }
+
+    printf("hamilton board=%dx%d cycle=%d build=%.1fms ticks=%d length=%d over=%d decide=%.3fus\n",
+        size, size, cycle.length, buildTime * 1e3, state->ticks, state->length, state->isOver, decideTime / state->ticks * 1e6);
+
+    HamiltonFree(&cycle);
+    SimRelease(state);
+    SimTileMapRelease(simTileMap);
+    free(tileMap.tiles);
+    free(bodyCells);
+    free(state);
+}
+
+static void BenchFloodFill(void) {
+    int sizes[] = {64, 256, 512};
+    uint64_t rng = 1;
+
+#if defined(__AVX2__)
+    const char *kernel = "avx2";
+#elif defined(__SSE2__)
+    const char *kernel = "sse2";
+#else
+    const char *kernel = "scalar";
+#endif
+
+    for (int s = 0; s < 3; s++) {
+        int size = sizes[s];
+        TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+        BitGrid open;
+        BitGrid reached;
+
+        tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+
+        for (int i = 0; i < size * size / 5; i++) {
+            tileMap.tiles[SimRandom(&rng) % (size * size)] = TILE_WALL;
+        }
+
+        tileMap.tiles[0] = TILE_EMPTY;
+
+        BitGridInit(&open, size, size);
+        BitGridInit(&reached, size, size);
+        BitGridFromTileMap(&open, &tileMap);
+
+        int iterations = 2000;
+        int count = 0;
+        double start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            count = BitGridFloodFill(&open, 0, &reached);
+        }
+
+        double time = BenchNow() - start;
+
+        printf("floodfill kernel=%s board=%dx%d walls=20%% reached=%d fill=%.2fus\n",
+            kernel, size, size, count, time / iterations * 1e6);
+
+        BitGridFree(&open);
+        BitGridFree(&reached);
+        free(tileMap.tiles);
+    }
+}
+
+// Plays a game on a 20x20 board with a 20 Hz tick budget per move
+static void BenchMcts(void) {
+    SimTileMap *tileMap = BenchCreateTileMap(20, 20);
+    SimState *state = (SimState*) malloc(sizeof(SimState));
+    TilePosition head = {.row = 1, .col = 1};
+    Mcts mcts;
+    double budget = 0.05 * 0.8;
+    long long iterations = 0;
+    double worstStop = 0;
+    int moves = 0;
+
+    MctsInit(&mcts, ClockGetCoreCount(), 1 << 18);
+    SimInit(state, tileMap, head, 1);
+
+    while (!state->isOver && moves < 100) {
+        MctsStart(&mcts, state, budget);
+
+        while (ClockNow() < mcts.deadline) {
+            // The game loop keeps running while the search works
+        }
+
+        double start = BenchNow();
+        MctsStop(&mcts);
+        double stopTime = BenchNow() - start;
+
+        worstStop = stopTime > worstStop ? stopTime : worstStop;
+        iterations += atomic_load(&mcts.iterations);
+
+        SimStep(state, MctsGetMove(&mcts));
+        moves++;
+    }
+
+    printf("mcts threads=%d moves=%d score=%d over=%d playouts/move=%lld worst-stop=%.1fus\n",
+        mcts.threadCount, moves, state->score, state->isOver, iterations / moves, worstStop * 1e6);
+
+    MctsFree(&mcts);
+    SimRelease(state);
+    SimTileMapRelease(tileMap);
+    free(state);
+}
+
+static void BenchObserve(void) {
+    int sizes[] = {10, 20, 84};
+    uint64_t rng = 1;
+
+    for (int s = 0; s < 3; s++) {
+        int size = sizes[s];
+        SimTileMap *tileMap = BenchCreateTileMap(size, size);
+        SimState *state = (SimState*) malloc(sizeof(SimState));
+        TilePosition head = {.row = 0, .col = 0};
+        float *planes = (float*) malloc(sizeof(float) * OBSERVE_PLANE_COUNT * size * size);
+        uint8_t *bytes = (uint8_t*) malloc(OBSERVE_PLANE_COUNT * size * size);
+
+        SimInit(state, tileMap, head, 1);
+
+        for (int i = 0; i < size * size / 10; i++) {
+            SimSetTile(state, size + SimRandom(&rng) % (size * (size - 1)), TILE_WALL);
+        }
+
+        BenchGrowSnake(state, size * size / 4);
+
+        int iterations = 200000 / size;
+        double start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            ObserveFloat(state, planes);
+            BenchClobber();
+        }
+
+        double floatTime = BenchNow() - start;
+        start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            ObserveUint8(state, bytes);
+            BenchClobber();
+        }
+
+        double byteTime = BenchNow() - start;
+
+        printf("observe board=%dx%d length=%d float32=%.2fus uint8=%.2fus\n",
+            size, size, state->length, floatTime / iterations * 1e6, byteTime / iterations * 1e6);
+
+        free(planes);
+        free(bytes);
+        SimRelease(state);
+        SimTileMapRelease(tileMap);
+        free(state);
+    }
+}
+
+static void BenchNeural(void) {
+    int hiddenCounts[] = {16, 32, 64};
+    SimTileMap *tileMap = BenchCreateTileMap(20, 20);
+    SimState *state = (SimState*) malloc(sizeof(SimState));
+    TilePosition head = {.row = 0, .col = 0};
+    uint64_t rng = 1;
+
+#if defined(__AVX2__)
+    const char *kernel = "avx2";
+#elif defined(__SSE2__)
+    const char *kernel = "sse2";
+#else
+    const char *kernel = "scalar";
+#endif
+
+    SimInit(state, tileMap, head, 1);
+    BenchGrowSnake(state, 50);
+
+    for (int h = 0; h < 3; h++) {
+        NeuralNet net;
+        NeuralInit(&net, OBSERVE_PLANE_COUNT * 20 * 20, hiddenCounts[h]);
+
+        int count = NeuralGetParameterCount(&net);
+        float *parameters = (float*) malloc(sizeof(float) * count);
+
+        for (int i = 0; i < count; i++) {
+            parameters[i] = (float) (SimRandom(&rng) % 2001) / 1000.0f - 1.0f;
+        }
+
+        NeuralSetParameters(&net, parameters);
+
+        int iterations = 20000;
+        int direction = 0;
+        double start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            direction += NeuralChooseMove(&net, state);
+        }
+
+        double time = BenchNow() - start;
+
+        printf("neural kernel=%s board=20x20 inputs=%d hidden=%d decision=%.2fus (%d)\n",
+            kernel, net.inputCount, net.hiddenCount, time / iterations * 1e6, direction % 4);
+
+        free(parameters);
+        NeuralFree(&net);
+    }
+
+    SimRelease(state);
+    SimTileMapRelease(tileMap);
+    free(state);
+}
+
+static void BenchLevel(void) {
+    int size = 256;
+    TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+    LevelGenerator generator;
+
+    tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+    LevelGeneratorInit(&generator, size, size);
+
+    for (int style = 0; style < LEVEL_STYLE_COUNT; style++) {
+        int iterations = 50;
+        int attempts = 0;
+        int failures = 0;
+        double worst = 0;
+        double start = BenchNow();
+
+        for (int i = 0; i < iterations; i++) {
+            double levelStart = BenchNow();
+            failures += !LevelGenerate(&generator, &tileMap, style, i + 1, size + 1);
+            double levelTime = BenchNow() - levelStart;
+
+            attempts += generator.attempts;
+            worst = levelTime > worst ? levelTime : worst;
+        }
+
+        double time = BenchNow() - start;
+
+        printf("level style=%s board=%dx%d free=%d attempts=%.2f failures=%d generate=%.2fms worst=%.2fms\n",
+            levelStyleNames[style], size, size, generator.freeCount, (double) attempts / iterations, failures,
+            time / iterations * 1e3, worst * 1e3);
+    }
+
+    LevelGeneratorFree(&generator);
+    free(tileMap.tiles);
+}
+
+// Lays out length segments as a serpentine filling the board row by row
+static void BenchGrowSerpentine(SnakeBody *body, int length) {
+    int direction = SIM_RIGHT;
+
+    body->pendingGrowth = length - body->length;
+
+    while (body->length < length) {
+        int col = body->head % body->cols;
+
+        if ((direction == SIM_RIGHT && col == body->cols - 1) || (direction == SIM_LEFT && col == 0)) {
+            SnakeBodyMove(body, SIM_DOWN);
+            direction = direction == SIM_RIGHT ? SIM_LEFT : SIM_RIGHT;
+        } else {
+            SnakeBodyMove(body, direction);
+        }
+    }
+}
+
+// Quads GameDrawSnake emits for the whole body, one per span
+static int BenchCountSpans(const SnakeBody *body) {
+    SnakeBodyCursor cursor;
+    SnakeBodySpan span;
+    int spans = 0;
+
+    SnakeBodyBegin(&cursor, body);
+
+    while (SnakeBodyNextSpan(&cursor, body->length, GAME_SNAKE_SHADED_LENGTH, &span)) {
+        spans++;
+    }
+
+    return spans;
+}
+
+// Primitives for late game snakes, one per segment against one per span.
+// Bodies stop at the length the game allows.
+static void BenchRuns(void) {
+    int sizes[] = {20, 32, 64};
+    const char *bots[] = {"serpentine", "hamilton"};
+
+    for (int s = 0; s < 3; s++) {
+        int size = sizes[s];
+        TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+        HamiltonCycle cycle;
+
+        tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+        HamiltonInit(&cycle, size, size);
+        HamiltonBuild(&cycle, &tileMap, 0);
+
+        for (int bot = 0; bot < 2; bot++) {
+            SimTileMap *simTileMap = SimTileMapCreate(&tileMap);
+            SimState *state = (SimState*) malloc(sizeof(SimState));
+            SnakeBody body;
+            TilePosition head = {.row = 0, .col = 0};
+            int maxLength = size * size * 3 / 4 < GAME_SNAKE_TAIL_MAX_LENGTH ? size * size * 3 / 4 : GAME_SNAKE_TAIL_MAX_LENGTH;
+            long long segments = 0;
+            long long spans = 0;
+            int samples = 0;
+            double countTime = 0;
+
+            SimInit(state, simTileMap, head, 1);
+            SnakeBodyInit(&body, size, size, state->head);
+
+            if (bot == 0) {
+                BenchGrowSerpentine(&body, maxLength);
+            }
+
+            // Late game: every tick once the snake is two thirds of its final length, the serpentine is only measured full
+            while (true) {
+                if (body.length >= maxLength * 2 / 3) {
+                    double start = BenchNow();
+                    spans += BenchCountSpans(&body);
+                    countTime += BenchNow() - start;
+                    segments += body.length;
+                    samples++;
+                }
+
+                if (bot == 0 || state->isOver || state->ticks >= 2000000 || state->length >= maxLength) {
+                    break;
+                }
+
+                int direction = HamiltonGetDirection(&cycle, state->head, state->tail, state->appleCell, state->length + 1);
+
+                // The body follows the simulation, growth is laid out on the same moves
+                body.pendingGrowth = state->pendingGrowth;
+                SnakeBodyMove(&body, direction);
+                SimStep(state, direction);
+            }
+
+            printf("runs board=%dx%d snake=%s samples=%d segments=%.0f quads=%.1f ratio=%.1fx count=%.2fus\n",
+                size, size, bots[bot], samples, (double) segments / samples, (double) spans / samples,
+                (double) segments / spans, countTime / samples * 1e6);
+
+            SimRelease(state);
+            SimTileMapRelease(simTileMap);
+            SnakeBodyFree(&body);
+            free(state);
+        }
+
+        HamiltonFree(&cycle);
+        free(tileMap.tiles);
+    }
+}
+
+// Memory of a million segment snake laid out as a serpentine, against the
+// 24 bytes per segment (tile, pixel position and size) the game used to keep
+static void BenchBody(void) {
+    int widths[] = {1000, 10000, 100000};
+    int length = 1000000;
+
+    for (int w = 0; w < 3; w++) {
+        int cols = widths[w];
+        int rows = length / cols + 2;
+        SnakeBody body;
+
+        SnakeBodyInit(&body, rows, cols, 0);
+
+        double start = BenchNow();
+        BenchGrowSerpentine(&body, length);
+        double moveTime = (BenchNow() - start) / length;
+        SnakeBodyCursor cursor;
+        long long checksum = 0;
+
+        start = BenchNow();
+        SnakeBodyBegin(&cursor, &body);
+
+        while (SnakeBodyNext(&cursor)) {
+            checksum += cursor.cell;
+        }
+
+        double walkTime = BenchNow() - start;
+
+        printf("body segments=%d turns=%d memory=%.1fKB array=%.1fMB move=%.1fns walk=%.2fms checksum=%lld\n",
+            body.length, body.runCount - 1, SnakeBodyGetMemory(&body) / 1024.0, length * 24.0 / (1 << 20),
+            moveTime * 1e9, walkTime * 1e3, checksum);
+
+        SnakeBodyFree(&body);
+    }
+}
+
+typedef struct Bench
+{
+    const char *name;
+    void (*run)(void);
+} Bench;
+
+static Bench benches[] = {
+    {"fork", BenchFork},
+    {"bfs", BenchBfs},
+    {"dstar", BenchDStar},
+    {"hamilton", BenchHamilton},
+    {"floodfill", BenchFloodFill},
+    {"mcts", BenchMcts},
+    {"observe", BenchObserve},
+    {"neural", BenchNeural},
+    {"level", BenchLevel},
+    {"runs", BenchRuns},
+    {"body", BenchBody},
+};
+
+int main(int argc, char **argv) {
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (argc < 2 || strcmp(argv[1], benches[i].name) == 0) {
+            benches[i].run();
+        }
+    }
+
+    return 0;
+}
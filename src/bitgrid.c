@@ -0,0 +1,251 @@
+#include "bitgrid.h"
+#include "stdlib.h"
+#include "string.h"
+
+#if defined(__AVX2__)
+#include "immintrin.h"
+#elif defined(__SSE2__)
+#include "emmintrin.h"
+#endif
+
+#if defined(_WIN32)
+#include "malloc.h"
+#define BitGridAlignedAlloc(size) _aligned_malloc(size, 32)
+#define BitGridAlignedFree(pointer) _aligned_free(pointer)
+#else
+#define BitGridAlignedAlloc(size) aligned_alloc(32, size)
+#define BitGridAlignedFree(pointer) free(pointer)
+#endif
+
+#define BITGRID_ROW_ALIGNMENT 4
+
+void BitGridInit(BitGrid *grid, int rows, int cols) {
+    int stride = (cols + 63) / 64;
+
+    stride = (stride + BITGRID_ROW_ALIGNMENT - 1) / BITGRID_ROW_ALIGNMENT * BITGRID_ROW_ALIGNMENT;
+
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->stride = stride;
+    grid->words = (uint64_t*) BitGridAlignedAlloc(sizeof(uint64_t) * stride * rows);
+    memset(grid->words, 0, sizeof(uint64_t) * stride * rows);
+}
+
+void BitGridFree(BitGrid *grid) {
+    BitGridAlignedFree(grid->words);
+}
+
+void BitGridCopy(BitGrid *dst, const BitGrid *src) {
+    memcpy(dst->words, src->words, sizeof(uint64_t) * src->stride * src->rows);
+}
+
+void BitGridClear(BitGrid *grid) {
+    memset(grid->words, 0, sizeof(uint64_t) * grid->stride * grid->rows);
+}
+
+void BitGridFromTileMap(BitGrid *grid, TileMap *tileMap) {
+    memset(grid->words, 0, sizeof(uint64_t) * grid->stride * grid->rows);
+
+    for (int cell = 0; cell < grid->rows * grid->cols; cell++) {
+        if (tileMap->tiles[cell] != TILE_WALL) {
+            BitGridSet(grid, cell);
+        }
+    }
+}
+
+void BitGridSet(BitGrid *grid, int cell) {
+    int col = cell % grid->cols;
+    grid->words[(cell / grid->cols) * grid->stride + col / 64] |= 1ULL << (col % 64);
+}
+
+void BitGridReset(BitGrid *grid, int cell) {
+    int col = cell % grid->cols;
+    grid->words[(cell / grid->cols) * grid->stride + col / 64] &= ~(1ULL << (col % 64));
+}
+
+bool BitGridGet(const BitGrid *grid, int cell) {
+    int col = cell % grid->cols;
+    return (grid->words[(cell / grid->cols) * grid->stride + col / 64] >> (col % 64)) & 1;
+}
+
+int BitGridCount(const BitGrid *grid) {
+    int count = 0;
+
+    for (int i = 0; i < grid->stride * grid->rows; i++) {
+        count += __builtin_popcountll(grid->words[i]);
+    }
+
+    return count;
+}
+
+// Spreads reached bits along runs of open bits inside every 64 bit word
+static void BitGridFillWords(uint64_t *reached, const uint64_t *open, int stride) {
+#if defined(__AVX2__)
+    for (int w = 0; w < stride; w += 4) {
+        __m256i pro = _mm256_load_si256((const __m256i*) &open[w]);
+        __m256i up = _mm256_and_si256(_mm256_load_si256((const __m256i*) &reached[w]), pro);
+        __m256i down = up;
+        __m256i proUp = pro;
+        __m256i proDown = pro;
+
+        for (int shift = 1; shift < 64; shift *= 2) {
+            __m128i count = _mm_cvtsi32_si128(shift);
+            up = _mm256_or_si256(up, _mm256_and_si256(proUp, _mm256_sll_epi64(up, count)));
+            proUp = _mm256_and_si256(proUp, _mm256_sll_epi64(proUp, count));
+            down = _mm256_or_si256(down, _mm256_and_si256(proDown, _mm256_srl_epi64(down, count)));
+            proDown = _mm256_and_si256(proDown, _mm256_srl_epi64(proDown, count));
+        }
+
+        _mm256_store_si256((__m256i*) &reached[w], _mm256_or_si256(up, down));
+    }
+#elif defined(__SSE2__)
+    for (int w = 0; w < stride; w += 2) {
+        __m128i pro = _mm_load_si128((const __m128i*) &open[w]);
+        __m128i up = _mm_and_si128(_mm_load_si128((const __m128i*) &reached[w]), pro);
+        __m128i down = up;
+        __m128i proUp = pro;
+        __m128i proDown = pro;
+
+        for (int shift = 1; shift < 64; shift *= 2) {
+            __m128i count = _mm_cvtsi32_si128(shift);
+            up = _mm_or_si128(up, _mm_and_si128(proUp, _mm_sll_epi64(up, count)));
+            proUp = _mm_and_si128(proUp, _mm_sll_epi64(proUp, count));
+            down = _mm_or_si128(down, _mm_and_si128(proDown, _mm_srl_epi64(down, count)));
+            proDown = _mm_and_si128(proDown, _mm_srl_epi64(proDown, count));
+        }
+
+        _mm_store_si128((__m128i*) &reached[w], _mm_or_si128(up, down));
+    }
+#else
+    for (int w = 0; w < stride; w++) {
+        uint64_t up = reached[w] & open[w];
+        uint64_t down = up;
+        uint64_t proUp = open[w];
+        uint64_t proDown = open[w];
+
+        for (int shift = 1; shift < 64; shift *= 2) {
+            up |= proUp & (up << shift);
+            proUp &= proUp << shift;
+            down |= proDown & (down >> shift);
+            proDown &= proDown >> shift;
+        }
+
+        reached[w] = up | down;
+    }
+#endif
+}
+
+// Adds the open bits of a row that touch the reached bits of the row next to it
+static bool BitGridMergeRow(uint64_t *reached, const uint64_t *neighbor, const uint64_t *open, int stride) {
+    uint64_t changed = 0;
+
+#if defined(__AVX2__)
+    for (int w = 0; w < stride; w += 4) {
+        __m256i row = _mm256_load_si256((const __m256i*) &reached[w]);
+        __m256i add = _mm256_andnot_si256(row, _mm256_and_si256(_mm256_load_si256((const __m256i*) &neighbor[w]), _mm256_load_si256((const __m256i*) &open[w])));
+
+        changed |= !_mm256_testz_si256(add, add);
+        _mm256_store_si256((__m256i*) &reached[w], _mm256_or_si256(row, add));
+    }
+#elif defined(__SSE2__)
+    for (int w = 0; w < stride; w += 2) {
+        __m128i row = _mm_load_si128((const __m128i*) &reached[w]);
+        __m128i add = _mm_andnot_si128(row, _mm_and_si128(_mm_load_si128((const __m128i*) &neighbor[w]), _mm_load_si128((const __m128i*) &open[w])));
+
+        changed |= _mm_movemask_epi8(_mm_cmpeq_epi32(add, _mm_setzero_si128())) != 0xffff;
+        _mm_store_si128((__m128i*) &reached[w], _mm_or_si128(row, add));
+    }
+#else
+    for (int w = 0; w < stride; w++) {
+        uint64_t add = neighbor[w] & open[w] & ~reached[w];
+
+        changed |= add;
+        reached[w] |= add;
+    }
+#endif
+
+    return changed != 0;
+}
+
+// Fills a whole row, carrying across words and around the left and right edges
+static void BitGridFillRow(const BitGrid *grid, uint64_t *reached, const uint64_t *open) {
+    int lastWord = (grid->cols - 1) / 64;
+    int lastBit = (grid->cols - 1) % 64;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        BitGridFillWords(reached, open, grid->stride);
+
+        for (int w = 0; w < lastWord; w++) {
+            if ((reached[w] >> 63) && (open[w + 1] & 1) && !(reached[w + 1] & 1)) {
+                reached[w + 1] |= 1;
+                changed = true;
+            }
+
+            if ((reached[w + 1] & 1) && (open[w] >> 63) && !(reached[w] >> 63)) {
+                reached[w] |= 1ULL << 63;
+                changed = true;
+            }
+        }
+
+        bool firstReached = reached[0] & 1;
+        bool lastReached = (reached[lastWord] >> lastBit) & 1;
+
+        if (lastReached && !firstReached && (open[0] & 1)) {
+            reached[0] |= 1;
+            changed = true;
+        }
+
+        if (firstReached && !lastReached && ((open[lastWord] >> lastBit) & 1)) {
+            reached[lastWord] |= 1ULL << lastBit;
+            changed = true;
+        }
+    }
+}
+
+// Marks every open cell reachable from seedCell in reached and returns how many there are
+int BitGridFloodFill(const BitGrid *open, int seedCell, BitGrid *reached) {
+    int rows = open->rows;
+    int stride = open->stride;
+
+    memset(reached->words, 0, sizeof(uint64_t) * stride * rows);
+
+    if (!BitGridGet(open, seedCell)) {
+        return 0;
+    }
+
+    BitGridSet(reached, seedCell);
+    BitGridFillRow(open, &reached->words[(seedCell / open->cols) * stride], &open->words[(seedCell / open->cols) * stride]);
+
+    // Sweep down then up, each sweep carries the fill through whole columns
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+
+        for (int row = 0; row < rows; row++) {
+            int previous = row == 0 ? rows - 1 : row - 1;
+            uint64_t *words = &reached->words[row * stride];
+            const uint64_t *openWords = &open->words[row * stride];
+
+            if (BitGridMergeRow(words, &reached->words[previous * stride], openWords, stride)) {
+                BitGridFillRow(open, words, openWords);
+                changed = true;
+            }
+        }
+
+        for (int row = rows - 1; row >= 0; row--) {
+            int next = row == rows - 1 ? 0 : row + 1;
+            uint64_t *words = &reached->words[row * stride];
+            const uint64_t *openWords = &open->words[row * stride];
+
+            if (BitGridMergeRow(words, &reached->words[next * stride], openWords, stride)) {
+                BitGridFillRow(open, words, openWords);
+                changed = true;
+            }
+        }
+    }
+
+    return BitGridCount(reached);
+}
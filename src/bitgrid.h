@@ -0,0 +1,36 @@
+/**
+ * One bit per tile grid with a fast flood fill.
+ *
+ * Rows are padded to a multiple of 256 bits so whole words are expanded at
+ * once with SSE2 or AVX2 when the compiler targets them. Edges wrap around
+ * like the snake does.
+*/
+#ifndef BITGRID_H
+#define BITGRID_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "tilemap.h"
+
+typedef struct BitGrid
+{
+    int rows;
+    int cols;
+    int stride;       // Words per row
+    uint64_t *words;
+} BitGrid;
+
+void BitGridInit(BitGrid *grid, int rows, int cols);
+void BitGridFree(BitGrid *grid);
+void BitGridCopy(BitGrid *dst, const BitGrid *src);
+void BitGridClear(BitGrid *grid);
+void BitGridFromTileMap(BitGrid *grid, TileMap *tileMap);
+
+void BitGridSet(BitGrid *grid, int cell);
+void BitGridReset(BitGrid *grid, int cell);
+bool BitGridGet(const BitGrid *grid, int cell);
+int BitGridCount(const BitGrid *grid);
+
+int BitGridFloodFill(const BitGrid *open, int seedCell, BitGrid *reached);
+
+#endif
@@ -0,0 +1,14 @@
+/**
+ * Monotonic clock and core count shared by the search, the tools and the game.
+ *
+ * Both wrap the platform call (QueryPerformanceCounter and GetSystemInfo on
+ * Windows, clock_gettime and sysconf elsewhere) so callers can time budgets
+ * and size worker pools without their own ifdefs.
+*/
+#ifndef CLOCK_H
+#define CLOCK_H
+
+int ClockGetCoreCount(void);    // Online cores, at least 1
+double ClockNow(void);          // Seconds from an arbitrary start, monotonic
+
+#endif
@@ -0,0 +1,284 @@
+#include "dstar.h"
+#include "sim.h"
+#include "stdlib.h"
+#include "string.h"
+
+void DStarInit(DStarPlanner *planner, int rows, int cols) {
+    int cellCount = rows * cols;
+    TileMap tileMap = {.rows = rows, .cols = cols};
+
+    planner->rows = rows;
+    planner->cols = cols;
+    planner->neighbors = (int*) malloc(sizeof(int) * cellCount * 4);
+    planner->cellRows = (int*) malloc(sizeof(int) * cellCount);
+    planner->cellCols = (int*) malloc(sizeof(int) * cellCount);
+    planner->walls = (uint8_t*) calloc(cellCount, sizeof(uint8_t));
+    planner->occupancy = (uint16_t*) calloc(cellCount, sizeof(uint16_t));
+    planner->g = (int*) malloc(sizeof(int) * cellCount);
+    planner->rhs = (int*) malloc(sizeof(int) * cellCount);
+    planner->heap = (int*) malloc(sizeof(int) * cellCount);
+    planner->heapKeys = (DStarKey*) malloc(sizeof(DStarKey) * cellCount);
+    planner->heapIndex = (int*) malloc(sizeof(int) * cellCount);
+    planner->heapSize = 0;
+    planner->goal = -1;
+    planner->expanded = 0;
+
+    for (int cell = 0; cell < cellCount; cell++) {
+        planner->cellRows[cell] = cell / cols;
+        planner->cellCols[cell] = cell % cols;
+
+        for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+            planner->neighbors[cell * 4 + direction] = SimNeighbor(&tileMap, cell, direction);
+        }
+    }
+}
+
+void DStarFree(DStarPlanner *planner) {
+    free(planner->neighbors);
+    free(planner->cellRows);
+    free(planner->cellCols);
+    free(planner->walls);
+    free(planner->occupancy);
+    free(planner->g);
+    free(planner->rhs);
+    free(planner->heap);
+    free(planner->heapKeys);
+    free(planner->heapIndex);
+}
+
+// Manhattan distance on the wraparound grid
+static int DStarHeuristic(DStarPlanner *planner, int a, int b) {
+    int rows = abs(planner->cellRows[a] - planner->cellRows[b]);
+    int cols = abs(planner->cellCols[a] - planner->cellCols[b]);
+
+    if (rows > planner->rows - rows) {
+        rows = planner->rows - rows;
+    }
+
+    if (cols > planner->cols - cols) {
+        cols = planner->cols - cols;
+    }
+
+    return rows + cols;
+}
+
+static bool DStarIsBlocked(DStarPlanner *planner, int cell) {
+    return planner->walls[cell] || planner->occupancy[cell] > 0;
+}
+
+static bool DStarKeyLess(DStarKey a, DStarKey b) {
+    return a.primary < b.primary || (a.primary == b.primary && a.secondary < b.secondary);
+}
+
+static DStarKey DStarCalculateKey(DStarPlanner *planner, int cell) {
+    int value = planner->g[cell] < planner->rhs[cell] ? planner->g[cell] : planner->rhs[cell];
+    DStarKey key = {.primary = value, .secondary = value};
+
+    if (value < DSTAR_INFINITY) {
+        key.primary = value + DStarHeuristic(planner, planner->start, cell) + planner->km;
+    }
+
+    return key;
+}
+
+static void DStarHeapSwap(DStarPlanner *planner, int a, int b) {
+    int cell = planner->heap[a];
+    DStarKey key = planner->heapKeys[a];
+
+    planner->heap[a] = planner->heap[b];
+    planner->heapKeys[a] = planner->heapKeys[b];
+    planner->heap[b] = cell;
+    planner->heapKeys[b] = key;
+    planner->heapIndex[planner->heap[a]] = a;
+    planner->heapIndex[planner->heap[b]] = b;
+}
+
+static void DStarHeapFix(DStarPlanner *planner, int index) {
+    while (index > 0 && DStarKeyLess(planner->heapKeys[index], planner->heapKeys[(index - 1) / 2])) {
+        DStarHeapSwap(planner, index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+
+    while (true) {
+        int smallest = index;
+        int left = index * 2 + 1;
+        int right = left + 1;
+
+        if (left < planner->heapSize && DStarKeyLess(planner->heapKeys[left], planner->heapKeys[smallest])) {
+            smallest = left;
+        }
+
+        if (right < planner->heapSize && DStarKeyLess(planner->heapKeys[right], planner->heapKeys[smallest])) {
+            smallest = right;
+        }
+
+        if (smallest == index) {
+            break;
+        }
+
+        DStarHeapSwap(planner, index, smallest);
+        index = smallest;
+    }
+}
+
+static void DStarHeapSet(DStarPlanner *planner, int cell, DStarKey key) {
+    int index = planner->heapIndex[cell];
+
+    if (index < 0) {
+        index = planner->heapSize++;
+        planner->heap[index] = cell;
+        planner->heapIndex[cell] = index;
+    }
+
+    planner->heapKeys[index] = key;
+    DStarHeapFix(planner, index);
+}
+
+static void DStarHeapRemove(DStarPlanner *planner, int cell) {
+    int index = planner->heapIndex[cell];
+
+    if (index < 0) {
+        return;
+    }
+
+    planner->heapSize--;
+
+    if (index != planner->heapSize) {
+        DStarHeapSwap(planner, index, planner->heapSize);
+        planner->heapIndex[cell] = -1;
+        DStarHeapFix(planner, index);
+    } else {
+        planner->heapIndex[cell] = -1;
+    }
+}
+
+static void DStarUpdateCell(DStarPlanner *planner, int cell) {
+    if (cell != planner->goal) {
+        const int *neighbors = &planner->neighbors[cell * 4];
+        int rhs = DSTAR_INFINITY;
+
+        for (int direction = 0; direction < 4; direction++) {
+            int next = neighbors[direction];
+
+            if (!DStarIsBlocked(planner, next) && planner->g[next] + 1 < rhs) {
+                rhs = planner->g[next] + 1;
+            }
+        }
+
+        planner->rhs[cell] = rhs;
+    }
+
+    if (planner->g[cell] != planner->rhs[cell]) {
+        DStarHeapSet(planner, cell, DStarCalculateKey(planner, cell));
+    } else {
+        DStarHeapRemove(planner, cell);
+    }
+}
+
+static void DStarUpdateNeighbors(DStarPlanner *planner, int cell) {
+    const int *neighbors = &planner->neighbors[cell * 4];
+
+    for (int direction = 0; direction < 4; direction++) {
+        DStarUpdateCell(planner, neighbors[direction]);
+    }
+}
+
+static void DStarComputeShortestPath(DStarPlanner *planner) {
+    planner->expanded = 0;
+
+    while (planner->heapSize > 0) {
+        DStarKey startKey = DStarCalculateKey(planner, planner->start);
+
+        if (!DStarKeyLess(planner->heapKeys[0], startKey) && planner->rhs[planner->start] == planner->g[planner->start]) {
+            break;
+        }
+
+        int cell = planner->heap[0];
+        DStarKey oldKey = planner->heapKeys[0];
+        DStarKey newKey = DStarCalculateKey(planner, cell);
+
+        planner->expanded++;
+
+        if (DStarKeyLess(oldKey, newKey)) {
+            DStarHeapSet(planner, cell, newKey);
+        } else if (planner->g[cell] > planner->rhs[cell]) {
+            planner->g[cell] = planner->rhs[cell];
+            DStarHeapRemove(planner, cell);
+
+            // Entering a blocked cell costs infinity so its neighbors do not improve
+            if (!DStarIsBlocked(planner, cell)) {
+                DStarUpdateNeighbors(planner, cell);
+            }
+        } else {
+            planner->g[cell] = DSTAR_INFINITY;
+            DStarUpdateCell(planner, cell);
+            DStarUpdateNeighbors(planner, cell);
+        }
+    }
+}
+
+void DStarReset(DStarPlanner *planner, TileMap *tileMap, const int *occupiedCells, int occupiedCount, int start, int goal) {
+    int cellCount = planner->rows * planner->cols;
+
+    for (int cell = 0; cell < cellCount; cell++) {
+        planner->walls[cell] = tileMap->tiles[cell] == TILE_WALL;
+        planner->occupancy[cell] = 0;
+        planner->g[cell] = DSTAR_INFINITY;
+        planner->rhs[cell] = DSTAR_INFINITY;
+        planner->heapIndex[cell] = -1;
+    }
+
+    for (int i = 0; i < occupiedCount; i++) {
+        planner->occupancy[occupiedCells[i]]++;
+    }
+
+    planner->heapSize = 0;
+    planner->start = start;
+    planner->lastStart = start;
+    planner->goal = goal;
+    planner->km = 0;
+    planner->rhs[goal] = 0;
+
+    DStarHeapSet(planner, goal, DStarCalculateKey(planner, goal));
+}
+
+void DStarSetOccupied(DStarPlanner *planner, int cell, int delta) {
+    bool wasBlocked = DStarIsBlocked(planner, cell);
+
+    planner->occupancy[cell] += delta;
+
+    // Only the cost of the edges going into the cell change
+    if (planner->goal >= 0 && wasBlocked != DStarIsBlocked(planner, cell)) {
+        DStarUpdateNeighbors(planner, cell);
+    }
+}
+
+void DStarMoveStart(DStarPlanner *planner, int start) {
+    planner->start = start;
+    planner->km += DStarHeuristic(planner, planner->lastStart, start);
+    planner->lastStart = start;
+}
+
+// Repairs the previous search and returns the direction of the first step or -1 when there is no path
+int DStarPlan(DStarPlanner *planner) {
+    if (planner->goal < 0) {
+        return -1;
+    }
+
+    DStarComputeShortestPath(planner);
+
+    const int *neighbors = &planner->neighbors[planner->start * 4];
+    int bestDirection = -1;
+    int bestCost = DSTAR_INFINITY;
+
+    for (int direction = 0; direction < 4; direction++) {
+        int next = neighbors[direction];
+
+        if (!DStarIsBlocked(planner, next) && planner->g[next] < bestCost) {
+            bestCost = planner->g[next];
+            bestDirection = direction;
+        }
+    }
+
+    return bestDirection;
+}
@@ -0,0 +1,57 @@
+/**
+ * Incremental shortest path planner (D* Lite) for the autopilot.
+ *
+ * The search runs from the goal towards the head so when the head moves and a
+ * few cells change occupancy only the affected part of the previous search is
+ * repaired instead of searching the whole board again. Occupied cells are
+ * counted, so a tail segment stacked on another one (growth) is handled.
+*/
+#ifndef DSTAR_H
+#define DSTAR_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "tilemap.h"
+
+#define DSTAR_INFINITY 0x3fffffff
+
+typedef struct DStarKey
+{
+    int primary;
+    int secondary;
+} DStarKey;
+
+typedef struct DStarPlanner
+{
+    int rows;
+    int cols;
+    int *neighbors;        // 4 per cell, indexed with SimDirection
+    int *cellRows;
+    int *cellCols;
+    uint8_t *walls;
+    uint16_t *occupancy;   // Snake segments in the cell, head included
+
+    int *g;
+    int *rhs;
+    int *heap;
+    DStarKey *heapKeys;
+    int *heapIndex;        // Position in the heap or -1
+    int heapSize;
+
+    int start;
+    int lastStart;
+    int goal;              // -1 until DStarReset is called
+    int km;
+
+    int expanded;          // Cells popped by the last DStarPlan, for benchmarks
+} DStarPlanner;
+
+void DStarInit(DStarPlanner *planner, int rows, int cols);
+void DStarFree(DStarPlanner *planner);
+
+void DStarReset(DStarPlanner *planner, TileMap *tileMap, const int *occupiedCells, int occupiedCount, int start, int goal);
+void DStarSetOccupied(DStarPlanner *planner, int cell, int delta);
+void DStarMoveStart(DStarPlanner *planner, int start);
+int DStarPlan(DStarPlanner *planner);
+
+#endif
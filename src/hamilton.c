@@ -0,0 +1,202 @@
+#include "hamilton.h"
+#include "sim.h"
+#include "stdlib.h"
+
+#define HAMILTON_EDGE_UP 1
+#define HAMILTON_EDGE_RIGHT 2
+#define HAMILTON_EDGE_DOWN 4
+#define HAMILTON_EDGE_LEFT 8
+#define HAMILTON_BLOCK_FREE 16
+#define HAMILTON_BLOCK_VISITED 32
+
+void HamiltonInit(HamiltonCycle *cycle, int rows, int cols) {
+    int blockCount = (rows / 2) * (cols / 2);
+
+    cycle->rows = rows;
+    cycle->cols = cols;
+    cycle->order = (int*) malloc(sizeof(int) * rows * cols);
+    cycle->next = (int*) malloc(sizeof(int) * rows * cols);
+    cycle->blocks = (int*) malloc(sizeof(int) * (blockCount > 0 ? blockCount : 1));
+    cycle->queue = (int*) malloc(sizeof(int) * (blockCount > 0 ? blockCount : 1));
+    cycle->length = 0;
+}
+
+void HamiltonFree(HamiltonCycle *cycle) {
+    free(cycle->order);
+    free(cycle->next);
+    free(cycle->blocks);
+    free(cycle->queue);
+}
+
+static int HamiltonDistance(HamiltonCycle *cycle, int from, int to) {
+    int distance = cycle->order[to] - cycle->order[from];
+    return distance < 0 ? distance + cycle->length : distance;
+}
+
+// Grows a breadth first spanning tree over the wall free blocks connected to startBlock
+static void HamiltonBuildTree(HamiltonCycle *cycle, int startBlock) {
+    int blockRows = cycle->rows / 2;
+    int blockCols = cycle->cols / 2;
+    int head = 0;
+    int tail = 0;
+
+    cycle->queue[tail++] = startBlock;
+    cycle->blocks[startBlock] |= HAMILTON_BLOCK_VISITED;
+
+    while (head < tail) {
+        int block = cycle->queue[head++];
+        int row = block / blockCols;
+        int col = block % blockCols;
+        int neighbors[4] = {
+            ((row + blockRows - 1) % blockRows) * blockCols + col,
+            row * blockCols + (col + 1) % blockCols,
+            ((row + 1) % blockRows) * blockCols + col,
+            row * blockCols + (col + blockCols - 1) % blockCols,
+        };
+
+        // Blocks only wrap around when no tile is left over on that axis
+        if (cycle->rows % 2 != 0) {
+            neighbors[0] = row == 0 ? block : neighbors[0];
+            neighbors[2] = row == blockRows - 1 ? block : neighbors[2];
+        }
+
+        if (cycle->cols % 2 != 0) {
+            neighbors[1] = col == blockCols - 1 ? block : neighbors[1];
+            neighbors[3] = col == 0 ? block : neighbors[3];
+        }
+
+        int edges[4] = {HAMILTON_EDGE_UP, HAMILTON_EDGE_RIGHT, HAMILTON_EDGE_DOWN, HAMILTON_EDGE_LEFT};
+
+        for (int direction = 0; direction < 4; direction++) {
+            int next = neighbors[direction];
+
+            if (next == block || (cycle->blocks[next] & HAMILTON_BLOCK_VISITED) || !(cycle->blocks[next] & HAMILTON_BLOCK_FREE)) {
+                continue;
+            }
+
+            cycle->blocks[next] |= HAMILTON_BLOCK_VISITED | edges[(direction + 2) % 4];
+            cycle->blocks[block] |= edges[direction];
+            cycle->queue[tail++] = next;
+        }
+    }
+}
+
+bool HamiltonBuild(HamiltonCycle *cycle, TileMap *tileMap, int startCell) {
+    int rows = cycle->rows;
+    int cols = cycle->cols;
+    int blockCols = cols / 2;
+    int blockCount = (rows / 2) * blockCols;
+
+    cycle->length = 0;
+
+    for (int cell = 0; cell < rows * cols; cell++) {
+        cycle->order[cell] = -1;
+        cycle->next[cell] = -1;
+    }
+
+    if (blockCount == 0) {
+        return false;
+    }
+
+    for (int block = 0; block < blockCount; block++) {
+        int cell = (block / blockCols) * 2 * cols + (block % blockCols) * 2;
+        bool isFree = tileMap->tiles[cell] != TILE_WALL && tileMap->tiles[cell + 1] != TILE_WALL
+            && tileMap->tiles[cell + cols] != TILE_WALL && tileMap->tiles[cell + cols + 1] != TILE_WALL;
+
+        cycle->blocks[block] = isFree ? HAMILTON_BLOCK_FREE : 0;
+    }
+
+    int startRow = startCell / cols;
+    int startCol = startCell % cols;
+
+    if (startRow >= (rows / 2) * 2 || startCol >= blockCols * 2) {
+        return false;
+    }
+
+    int startBlock = (startRow / 2) * blockCols + startCol / 2;
+
+    if (!(cycle->blocks[startBlock] & HAMILTON_BLOCK_FREE)) {
+        return false;
+    }
+
+    HamiltonBuildTree(cycle, startBlock);
+
+    // Each tile of a block moves clockwise around the block unless a tree edge
+    // on its side sends it into the neighbor block
+    TileMap grid = {.rows = rows, .cols = cols};
+
+    for (int block = 0; block < blockCount; block++) {
+        int edges = cycle->blocks[block];
+
+        if (!(edges & HAMILTON_BLOCK_VISITED)) {
+            continue;
+        }
+
+        int topLeft = (block / blockCols) * 2 * cols + (block % blockCols) * 2;
+
+        cycle->next[topLeft] = SimNeighbor(&grid, topLeft, edges & HAMILTON_EDGE_UP ? SIM_UP : SIM_RIGHT);
+        cycle->next[topLeft + 1] = SimNeighbor(&grid, topLeft + 1, edges & HAMILTON_EDGE_RIGHT ? SIM_RIGHT : SIM_DOWN);
+        cycle->next[topLeft + cols + 1] = SimNeighbor(&grid, topLeft + cols + 1, edges & HAMILTON_EDGE_DOWN ? SIM_DOWN : SIM_LEFT);
+        cycle->next[topLeft + cols] = SimNeighbor(&grid, topLeft + cols, edges & HAMILTON_EDGE_LEFT ? SIM_LEFT : SIM_UP);
+    }
+
+    int cell = startCell;
+
+    do {
+        cycle->order[cell] = cycle->length++;
+        cell = cycle->next[cell];
+    } while (cell != startCell);
+
+    return true;
+}
+
+// Follows the cycle, cutting ahead towards the apple when the jump cannot land on the body
+int HamiltonGetDirection(HamiltonCycle *cycle, int head, int tail, int apple, int snakeLength) {
+    if (cycle->order[head] < 0) {
+        return -1;
+    }
+
+    TileMap grid = {.rows = cycle->rows, .cols = cycle->cols};
+    int freeCells = cycle->length - snakeLength;
+    int tailDistance = head == tail ? cycle->length : HamiltonDistance(cycle, head, tail);
+    int maxCut = 0;
+
+    // Shortcuts only while the board is mostly empty, then the cycle alone fills it
+    if (apple >= 0 && cycle->order[apple] >= 0 && freeCells * 2 > cycle->length) {
+        int appleDistance = HamiltonDistance(cycle, head, apple);
+
+        // Leave room for the segments the apple adds
+        maxCut = tailDistance - 4;
+
+        if (appleDistance < tailDistance && (tailDistance - appleDistance) * 4 > freeCells) {
+            maxCut -= 10;
+        }
+
+        if (maxCut > appleDistance) {
+            maxCut = appleDistance;
+        }
+    }
+
+    int bestDirection = -1;
+    int bestDistance = 0;
+
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        int next = SimNeighbor(&grid, head, direction);
+
+        if (cycle->order[next] < 0) {
+            continue;
+        }
+
+        int distance = HamiltonDistance(cycle, head, next);
+
+        if (distance == 1 && bestDirection < 0) {
+            bestDirection = direction;
+            bestDistance = distance;
+        } else if (distance > bestDistance && distance <= maxCut) {
+            bestDirection = direction;
+            bestDistance = distance;
+        }
+    }
+
+    return bestDirection;
+}
@@ -0,0 +1,35 @@
+/**
+ * Hamiltonian cycle over the free tiles, used by the Hamilton control mode.
+ *
+ * The board is split in 2x2 blocks, a spanning tree is grown over the blocks
+ * without walls and the cycle walks around that tree, so it visits every tile
+ * of those blocks. Tiles in blocks touching a wall (or in the last row or
+ * column of an odd sized board) are left out of the cycle.
+ *
+ * While the snake follows the cycle its body lies between the tail and the
+ * head in cycle order, so a shortcut is safe when it lands before the tail.
+ * That check only needs the position of a few cells in the cycle.
+*/
+#ifndef HAMILTON_H
+#define HAMILTON_H
+
+#include "stdbool.h"
+#include "tilemap.h"
+
+typedef struct HamiltonCycle
+{
+    int rows;
+    int cols;
+    int *order;     // Position of each cell in the cycle or -1
+    int *next;      // Next cell in the cycle or -1
+    int *blocks;    // Scratch for building, tree edges per block
+    int *queue;
+    int length;
+} HamiltonCycle;
+
+void HamiltonInit(HamiltonCycle *cycle, int rows, int cols);
+void HamiltonFree(HamiltonCycle *cycle);
+bool HamiltonBuild(HamiltonCycle *cycle, TileMap *tileMap, int startCell);
+int HamiltonGetDirection(HamiltonCycle *cycle, int head, int tail, int apple, int snakeLength);
+
+#endif
@@ -0,0 +1,38 @@
+#include "input.h"
+
+void InputRingInit(InputRing *ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+bool InputRingPush(InputRing *ring, InputEvent event) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail == INPUT_RING_SIZE) {
+        return false;
+    }
+
+    ring->events[head % INPUT_RING_SIZE] = event;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    return true;
+}
+
+bool InputRingPop(InputRing *ring, InputEvent *event) {
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *event = ring->events[tail % INPUT_RING_SIZE];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    return true;
+}
+
+bool InputRingIsEmpty(InputRing *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire) == atomic_load_explicit(&ring->tail, memory_order_relaxed);
+}
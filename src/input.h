@@ -0,0 +1,38 @@
+/**
+ * Lock free single producer, single consumer ring of input events.
+ *
+ * The window thread pushes key events with the time they were delivered and
+ * the simulation drains them when it moves the snake. Each side only writes
+ * its own index, the other one is read with acquire ordering, so pushing and
+ * popping never wait on each other. A push into a full ring fails and the
+ * event is dropped.
+*/
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "stdbool.h"
+#include "stdatomic.h"
+
+#define INPUT_RING_SIZE 64 // Power of two
+
+typedef struct InputEvent
+{
+    int key;        // Raylib key code
+    double time;    // Seconds, same clock as GetTime()
+} InputEvent;
+
+typedef struct InputRing
+{
+    atomic_uint head;           // Next slot written by the producer
+    char headPadding[60];       // Indices on their own cache lines
+    atomic_uint tail;           // Next slot read by the consumer
+    char tailPadding[60];
+    InputEvent events[INPUT_RING_SIZE];
+} InputRing;
+
+void InputRingInit(InputRing *ring);
+bool InputRingPush(InputRing *ring, InputEvent event);
+bool InputRingPop(InputRing *ring, InputEvent *event);
+bool InputRingIsEmpty(InputRing *ring);
+
+#endif
@@ -0,0 +1,120 @@
+#include "jobs.h"
+#include "stdlib.h"
+#include "stdbool.h"
+#include "pthread.h"
+
+#if defined(_WIN32)
+#include "malloc.h"
+#define JobsAlignedAlloc(size) _aligned_malloc(size, 64)
+#define JobsAlignedFree(pointer) _aligned_free(pointer)
+#else
+#define JobsAlignedAlloc(size) aligned_alloc(64, size)
+#define JobsAlignedFree(pointer) free(pointer)
+#endif
+
+typedef struct JobSystem
+{
+    int workerCount;
+    JobRange *ranges;
+    JobFunction function;
+    void *context;
+} JobSystem;
+
+typedef struct JobWorker
+{
+    JobSystem *system;
+    int index;
+} JobWorker;
+
+static uint64_t JobsPack(uint32_t begin, uint32_t end) {
+    return ((uint64_t) begin << 32) | end;
+}
+
+static bool JobsPop(JobRange *range, uint32_t *job) {
+    uint64_t value = atomic_load_explicit(&range->range, memory_order_acquire);
+
+    while (true) {
+        uint32_t begin = value >> 32;
+        uint32_t end = (uint32_t) value;
+
+        if (begin >= end) {
+            return false;
+        }
+
+        if (atomic_compare_exchange_weak_explicit(&range->range, &value, JobsPack(begin + 1, end), memory_order_acq_rel, memory_order_acquire)) {
+            *job = begin;
+            return true;
+        }
+    }
+}
+
+static bool JobsSteal(JobSystem *system, int thief) {
+    for (int i = 1; i < system->workerCount; i++) {
+        JobRange *victim = &system->ranges[(thief + i) % system->workerCount];
+        uint64_t value = atomic_load_explicit(&victim->range, memory_order_acquire);
+
+        while (true) {
+            uint32_t begin = value >> 32;
+            uint32_t end = (uint32_t) value;
+
+            if (begin >= end) {
+                break;
+            }
+
+            uint32_t split = end - (end - begin + 1) / 2;
+
+            if (atomic_compare_exchange_weak_explicit(&victim->range, &value, JobsPack(begin, split), memory_order_acq_rel, memory_order_acquire)) {
+                atomic_store_explicit(&system->ranges[thief].range, JobsPack(split, end), memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void* JobsWorkerRun(void *data) {
+    JobWorker *worker = (JobWorker*) data;
+    JobSystem *system = worker->system;
+    uint32_t job;
+
+    do {
+        while (JobsPop(&system->ranges[worker->index], &job)) {
+            system->function(system->context, worker->index, job);
+        }
+    } while (JobsSteal(system, worker->index));
+
+    return NULL;
+}
+
+// Runs function for every job in [0, jobCount) on workerCount threads, the caller is worker 0
+void JobsRun(int workerCount, uint32_t jobCount, JobFunction function, void *context) {
+    JobSystem system = {.workerCount = workerCount > 0 ? workerCount : 1, .function = function, .context = context};
+    pthread_t *threads = (pthread_t*) malloc(sizeof(pthread_t) * system.workerCount);
+    JobWorker *workers = (JobWorker*) malloc(sizeof(JobWorker) * system.workerCount);
+
+    system.ranges = (JobRange*) JobsAlignedAlloc(sizeof(JobRange) * system.workerCount);
+
+    for (int i = 0; i < system.workerCount; i++) {
+        uint32_t begin = (uint64_t) jobCount * i / system.workerCount;
+        uint32_t end = (uint64_t) jobCount * (i + 1) / system.workerCount;
+
+        atomic_init(&system.ranges[i].range, JobsPack(begin, end));
+        workers[i].system = &system;
+        workers[i].index = i;
+    }
+
+    for (int i = 1; i < system.workerCount; i++) {
+        pthread_create(&threads[i], NULL, JobsWorkerRun, &workers[i]);
+    }
+
+    JobsWorkerRun(&workers[0]);
+
+    for (int i = 1; i < system.workerCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    JobsAlignedFree(system.ranges);
+    free(workers);
+    free(threads);
+}
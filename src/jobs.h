@@ -0,0 +1,25 @@
+/**
+ * Work stealing parallel for over independent jobs.
+ *
+ * Each worker owns a range of job indices and takes jobs from its front.
+ * A worker that runs dry steals the back half of another worker's range.
+ * Both ends live in one 64 bit word updated with compare-and-swap, so there
+ * are no locks and no shared counter every job has to go through.
+*/
+#ifndef JOBS_H
+#define JOBS_H
+
+#include "stdint.h"
+#include "stdatomic.h"
+
+typedef void (*JobFunction)(void *context, int worker, uint32_t job);
+
+typedef struct JobRange
+{
+    _Atomic uint64_t range;     // Next job in the high 32 bits, end in the low 32 bits
+    char padding[56];           // One range per cache line
+} JobRange;
+
+void JobsRun(int workerCount, uint32_t jobCount, JobFunction function, void *context);
+
+#endif
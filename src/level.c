@@ -0,0 +1,210 @@
+#include "level.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sim.h"
+
+#define LEVEL_MAZE_UNIT 4 // 2 tiles of corridor and 2 tiles of wall
+
+const char *levelStyleNames[LEVEL_STYLE_COUNT] = {
+    "Empty",
+    "Pillars",
+    "Rooms",
+    "Maze",
+};
+
+void LevelGeneratorInit(LevelGenerator *generator, int rows, int cols) {
+    int mazeCells = (rows / LEVEL_MAZE_UNIT + 1) * (cols / LEVEL_MAZE_UNIT + 1);
+
+    generator->rows = rows;
+    generator->cols = cols;
+    generator->stack = (int*) malloc(sizeof(int) * mazeCells);
+    generator->visited = (uint8_t*) malloc(mazeCells);
+    generator->lines = (int*) malloc(sizeof(int) * (rows / 6 + cols / 6 + 2));
+    generator->freeCount = 0;
+    generator->attempts = 0;
+
+    BitGridInit(&generator->open, rows, cols);
+    BitGridInit(&generator->reached, rows, cols);
+}
+
+void LevelGeneratorFree(LevelGenerator *generator) {
+    free(generator->stack);
+    free(generator->visited);
+    free(generator->lines);
+    BitGridFree(&generator->open);
+    BitGridFree(&generator->reached);
+}
+
+// Fills a rectangle, wrapping around the edges like the snake does
+static void LevelFill(TileMap *tileMap, int row, int col, int height, int width, TileValue value) {
+    for (int r = 0; r < height; r++) {
+        TileValue *tiles = tileMap->tiles + ((row + r) % tileMap->rows + tileMap->rows) % tileMap->rows * tileMap->cols;
+
+        for (int c = 0; c < width; c++) {
+            tiles[((col + c) % tileMap->cols + tileMap->cols) % tileMap->cols] = value;
+        }
+    }
+}
+
+static void LevelPlacePillars(TileMap *tileMap, uint64_t *rng) {
+    for (int row = 2; row + 2 <= tileMap->rows; row += 4) {
+        for (int col = 2; col + 2 <= tileMap->cols; col += 4) {
+            if (SimRandom(rng) % 2 == 0) {
+                LevelFill(tileMap, row, col, 2, 2, TILE_WALL);
+            }
+        }
+    }
+}
+
+// Even positions of wall lines, 6 to 12 tiles apart
+static int LevelPickLines(int size, int *lines, uint64_t *rng) {
+    int count = 0;
+
+    for (int position = 2 * (int) (SimRandom(rng) % 3); position + 8 <= size; position += 6 + 2 * (int) (SimRandom(rng) % 4)) {
+        lines[count++] = position;
+    }
+
+    return count;
+}
+
+static void LevelPlaceRooms(LevelGenerator *generator, TileMap *tileMap, uint64_t *rng) {
+    int *rowLines = generator->lines;
+    int rowCount = LevelPickLines(tileMap->rows, rowLines, rng);
+    int *colLines = generator->lines + rowCount;
+    int colCount = LevelPickLines(tileMap->cols, colLines, rng);
+
+    for (int i = 0; i < rowCount; i++) {
+        LevelFill(tileMap, rowLines[i], 0, 2, tileMap->cols, TILE_WALL);
+    }
+
+    for (int i = 0; i < colCount; i++) {
+        LevelFill(tileMap, 0, colLines[i], tileMap->rows, 2, TILE_WALL);
+    }
+
+    // One door in every wall between two crossings, the last span wraps around to the first line
+    for (int i = 0; i < rowCount; i++) {
+        for (int j = 0; j < (colCount > 0 ? colCount : 1); j++) {
+            int start = colCount > 0 ? colLines[j] + 2 : 0;
+            int end = colCount > 0 ? (j + 1 < colCount ? colLines[j + 1] : colLines[0] + tileMap->cols) : tileMap->cols;
+            int door = start + 2 * (int) (SimRandom(rng) % ((end - start) / 2));
+
+            LevelFill(tileMap, rowLines[i], door, 2, 2, TILE_EMPTY);
+        }
+    }
+
+    for (int i = 0; i < colCount; i++) {
+        for (int j = 0; j < (rowCount > 0 ? rowCount : 1); j++) {
+            int start = rowCount > 0 ? rowLines[j] + 2 : 0;
+            int end = rowCount > 0 ? (j + 1 < rowCount ? rowLines[j + 1] : rowLines[0] + tileMap->rows) : tileMap->rows;
+            int door = start + 2 * (int) (SimRandom(rng) % ((end - start) / 2));
+
+            LevelFill(tileMap, door, colLines[i], 2, 2, TILE_EMPTY);
+        }
+    }
+}
+
+static void LevelCarveMaze(LevelGenerator *generator, TileMap *tileMap, uint64_t *rng) {
+    int mazeRows = tileMap->rows / LEVEL_MAZE_UNIT;
+    int mazeCols = tileMap->cols / LEVEL_MAZE_UNIT;
+    int stackCount = 0;
+
+    if (mazeRows <= 0 || mazeCols <= 0) {
+        return;
+    }
+
+    LevelFill(tileMap, 0, 0, mazeRows * LEVEL_MAZE_UNIT, mazeCols * LEVEL_MAZE_UNIT, TILE_WALL);
+    memset(generator->visited, 0, (size_t) mazeRows * mazeCols);
+
+    for (int cell = 0; cell < mazeRows * mazeCols; cell++) {
+        LevelFill(tileMap, cell / mazeCols * LEVEL_MAZE_UNIT, cell % mazeCols * LEVEL_MAZE_UNIT, 2, 2, TILE_EMPTY);
+    }
+
+    generator->stack[stackCount++] = 0;
+    generator->visited[0] = 1;
+
+    while (stackCount > 0) {
+        int cell = generator->stack[stackCount - 1];
+        int row = cell / mazeCols;
+        int col = cell % mazeCols;
+        int neighbors[4];
+        int neighborCount = 0;
+
+        if (row > 0 && !generator->visited[cell - mazeCols]) neighbors[neighborCount++] = cell - mazeCols;
+        if (row + 1 < mazeRows && !generator->visited[cell + mazeCols]) neighbors[neighborCount++] = cell + mazeCols;
+        if (col > 0 && !generator->visited[cell - 1]) neighbors[neighborCount++] = cell - 1;
+        if (col + 1 < mazeCols && !generator->visited[cell + 1]) neighbors[neighborCount++] = cell + 1;
+
+        if (neighborCount == 0) {
+            stackCount--;
+            continue;
+        }
+
+        int next = neighbors[SimRandom(rng) % neighborCount];
+        int nextRow = next / mazeCols;
+        int nextCol = next % mazeCols;
+
+        // Open the 2x2 wall between the two corridors
+        LevelFill(tileMap, (row < nextRow ? nextRow : row) * LEVEL_MAZE_UNIT - (row != nextRow ? 2 : 0),
+            (col < nextCol ? nextCol : col) * LEVEL_MAZE_UNIT - (col != nextCol ? 2 : 0), 2, 2, TILE_EMPTY);
+
+        generator->visited[next] = 1;
+        generator->stack[stackCount++] = next;
+    }
+
+    // Loops, an eighth of the remaining inner walls
+    for (int cell = 0; cell < mazeRows * mazeCols; cell++) {
+        int row = cell / mazeCols * LEVEL_MAZE_UNIT;
+        int col = cell % mazeCols * LEVEL_MAZE_UNIT;
+
+        if (cell % mazeCols + 1 < mazeCols && SimRandom(rng) % 8 == 0) {
+            LevelFill(tileMap, row, col + 2, 2, 2, TILE_EMPTY);
+        }
+
+        if (cell / mazeCols + 1 < mazeRows && SimRandom(rng) % 8 == 0) {
+            LevelFill(tileMap, row + 2, col, 2, 2, TILE_EMPTY);
+        }
+    }
+}
+
+bool LevelValidate(LevelGenerator *generator, TileMap *tileMap, int startCell) {
+    BitGridFromTileMap(&generator->open, tileMap);
+    generator->freeCount = BitGridCount(&generator->open);
+
+    if (generator->freeCount < LEVEL_MIN_FREE_RATIO * tileMap->rows * tileMap->cols) {
+        return false;
+    }
+
+    return BitGridFloodFill(&generator->open, startCell, &generator->reached) == generator->freeCount;
+}
+
+bool LevelGenerate(LevelGenerator *generator, TileMap *tileMap, LevelStyle style, uint64_t seed, int startCell) {
+    int startRow = startCell / tileMap->cols / 2 * 2;
+    int startCol = startCell % tileMap->cols / 2 * 2;
+
+    for (generator->attempts = 1; generator->attempts <= LEVEL_MAX_ATTEMPTS; generator->attempts++) {
+        uint64_t rng = (seed + generator->attempts) * 0x9E3779B97F4A7C15ULL;
+
+        rng = rng != 0 ? rng : 1;
+        LevelFill(tileMap, 0, 0, tileMap->rows, tileMap->cols, TILE_EMPTY);
+
+        if (style == LEVEL_PILLARS) {
+            LevelPlacePillars(tileMap, &rng);
+        } else if (style == LEVEL_ROOMS) {
+            LevelPlaceRooms(generator, tileMap, &rng);
+        } else if (style == LEVEL_MAZE) {
+            LevelCarveMaze(generator, tileMap, &rng);
+        }
+
+        // Room to start moving in any direction
+        LevelFill(tileMap, startRow - 2, startCol - 2, 6, 6, TILE_EMPTY);
+
+        if (LevelValidate(generator, tileMap, startCell)) {
+            return true;
+        }
+    }
+
+    LevelFill(tileMap, 0, 0, tileMap->rows, tileMap->cols, TILE_EMPTY);
+    LevelValidate(generator, tileMap, startCell);
+
+    return false;
+}
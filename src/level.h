@@ -0,0 +1,57 @@
+/**
+ * Seeded level generator with a connectivity check.
+ *
+ * Walls are laid on the 2x2 block grid (even rows and columns) so the
+ * Hamilton mode still finds a cycle through the open blocks:
+ * - pillars: scattered 2x2 pillars with corridors between them
+ * - rooms: 2 tiles thick walls around rooms, every wall has a 2 tiles door
+ * - maze: 2 tiles wide corridors carved with a depth first search, with a
+ *   few extra openings so the snake is not always one move from a dead end
+ *
+ * Every level is validated with a flood fill: all open tiles must be
+ * reachable from the start and a minimum share of the board must be open.
+ * A level that fails is generated again from the next seed.
+*/
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "tilemap.h"
+#include "bitgrid.h"
+
+#define LEVEL_MAX_ATTEMPTS 16
+#define LEVEL_MIN_FREE_RATIO 0.4f
+
+typedef enum LevelStyle
+{
+    LEVEL_EMPTY,
+    LEVEL_PILLARS,
+    LEVEL_ROOMS,
+    LEVEL_MAZE,
+    LEVEL_STYLE_COUNT,
+} LevelStyle;
+
+extern const char *levelStyleNames[LEVEL_STYLE_COUNT];
+
+typedef struct LevelGenerator
+{
+    int rows;
+    int cols;
+    BitGrid open;
+    BitGrid reached;
+    int *stack;       // Maze cells still to visit
+    int *lines;       // Room wall positions
+    uint8_t *visited;
+    int freeCount;    // Open tiles of the last generated level
+    int attempts;     // Seeds tried for the last generated level
+} LevelGenerator;
+
+void LevelGeneratorInit(LevelGenerator *generator, int rows, int cols);
+void LevelGeneratorFree(LevelGenerator *generator);
+
+// False when no seed gave a valid level, the tile map is then left empty
+bool LevelGenerate(LevelGenerator *generator, TileMap *tileMap, LevelStyle style, uint64_t seed, int startCell);
+bool LevelValidate(LevelGenerator *generator, TileMap *tileMap, int startCell);
+
+#endif
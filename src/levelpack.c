@@ -0,0 +1,219 @@
+#include "levelpack.h"
+#include "string.h"
+
+#if defined(_WIN32)
+#include "windows.h"
+#else
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#endif
+
+bool LevelPackOpen(LevelPack *pack, const char *path) {
+    memset(pack, 0, sizeof(LevelPack));
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    HANDLE fileMapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+
+    if (fileMapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+
+    pack->file = file;
+    pack->fileMapping = fileMapping;
+    pack->size = (size_t) size.QuadPart;
+    pack->mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (pack->mapping == NULL) {
+        LevelPackClose(pack);
+        return false;
+    }
+#else
+    int file = open(path, O_RDONLY);
+    struct stat info;
+
+    if (file < 0) {
+        return false;
+    }
+
+    if (fstat(file, &info) != 0 || info.st_size < (off_t) sizeof(LevelPackHeader)) {
+        close(file);
+        return false;
+    }
+
+    pack->size = info.st_size;
+    pack->mapping = mmap(NULL, pack->size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if (pack->mapping == MAP_FAILED) {
+        pack->mapping = NULL;
+        return false;
+    }
+#endif
+
+    const LevelPackHeader *header = (const LevelPackHeader*) pack->mapping;
+
+    // Only the header and the index size are checked here, entries are checked when decoded
+    if (pack->size < sizeof(LevelPackHeader) || header->magic != LEVEL_PACK_MAGIC ||
+        pack->size < sizeof(LevelPackHeader) + (uint64_t) header->levelCount * sizeof(LevelPackEntry)) {
+        LevelPackClose(pack);
+        return false;
+    }
+
+    pack->header = header;
+    pack->entries = (const LevelPackEntry*) (header + 1);
+
+    return true;
+}
+
+void LevelPackClose(LevelPack *pack) {
+#if defined(_WIN32)
+    if (pack->mapping != NULL) {
+        UnmapViewOfFile(pack->mapping);
+    }
+
+    if (pack->fileMapping != NULL) {
+        CloseHandle(pack->fileMapping);
+    }
+
+    if (pack->file != NULL) {
+        CloseHandle(pack->file);
+    }
+#else
+    if (pack->mapping != NULL) {
+        munmap(pack->mapping, pack->size);
+    }
+#endif
+
+    memset(pack, 0, sizeof(LevelPack));
+}
+
+int LevelPackGetCount(const LevelPack *pack) {
+    return pack->header != NULL ? (int) pack->header->levelCount : 0;
+}
+
+static bool LevelPackDecodeBits(const uint8_t *data, size_t size, TileValue *tiles, int tileCount) {
+    if (size < (size_t) (tileCount + 7) / 8) {
+        return false;
+    }
+
+    for (int i = 0; i < tileCount; i++) {
+        tiles[i] = (data[i / 8] >> (i % 8)) & 1 ? TILE_WALL : TILE_EMPTY;
+    }
+
+    return true;
+}
+
+static bool LevelPackDecodeRle(const uint8_t *data, size_t size, TileValue *tiles, int tileCount) {
+    TileValue value = TILE_EMPTY;
+    size_t offset = 0;
+    int cell = 0;
+
+    while (cell < tileCount) {
+        uint32_t run = 0;
+
+        for (int shift = 0; ; shift += 7) {
+            if (offset >= size || shift > 28) {
+                return false;
+            }
+
+            uint8_t byte = data[offset++];
+            run |= (uint32_t) (byte & 0x7F) << shift;
+
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+
+        if (run > (uint32_t) (tileCount - cell)) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < run; i++) {
+            tiles[cell++] = value;
+        }
+
+        value = value == TILE_EMPTY ? TILE_WALL : TILE_EMPTY;
+    }
+
+    return true;
+}
+
+bool LevelPackDecode(const LevelPack *pack, int index, TileMap *tileMap) {
+    if (index < 0 || index >= LevelPackGetCount(pack)) {
+        return false;
+    }
+
+    const LevelPackEntry *entry = &pack->entries[index];
+
+    if (entry->rows != tileMap->rows || entry->cols != tileMap->cols ||
+        entry->offset > pack->size || entry->size > pack->size - entry->offset) {
+        return false;
+    }
+
+    const uint8_t *data = (const uint8_t*) pack->mapping + entry->offset;
+    int tileCount = tileMap->rows * tileMap->cols;
+
+    if (entry->encoding == LEVEL_PACK_BITS) {
+        return LevelPackDecodeBits(data, entry->size, tileMap->tiles, tileCount);
+    } else if (entry->encoding == LEVEL_PACK_RLE) {
+        return LevelPackDecodeRle(data, entry->size, tileMap->tiles, tileCount);
+    }
+
+    return false;
+}
+
+size_t LevelPackGetMaxEncodedSize(int rows, int cols) {
+    // The run length encoding stops once it is no smaller than the bits, one varint past them at most
+    return (size_t) (rows * cols + 7) / 8 + 5;
+}
+
+size_t LevelPackEncode(const TileMap *tileMap, uint8_t *buffer, LevelPackEncoding *encoding) {
+    int tileCount = tileMap->rows * tileMap->cols;
+    size_t bitsSize = (size_t) (tileCount + 7) / 8;
+    size_t size = 0;
+    int cell = 0;
+    TileValue value = TILE_EMPTY;
+
+    while (cell < tileCount && size < bitsSize) {
+        uint32_t run = 0;
+
+        // Anything that is not a wall is stored as empty
+        while (cell < tileCount && (tileMap->tiles[cell] == TILE_WALL) == (value == TILE_WALL)) {
+            run++;
+            cell++;
+        }
+
+        do {
+            buffer[size++] = (run & 0x7F) | (run >= 0x80 ? 0x80 : 0);
+            run >>= 7;
+        } while (run != 0);
+
+        value = value == TILE_EMPTY ? TILE_WALL : TILE_EMPTY;
+    }
+
+    if (cell == tileCount && size < bitsSize) {
+        *encoding = LEVEL_PACK_RLE;
+        return size;
+    }
+
+    memset(buffer, 0, bitsSize);
+
+    for (int i = 0; i < tileCount; i++) {
+        if (tileMap->tiles[i] == TILE_WALL) {
+            buffer[i / 8] |= 1 << (i % 8);
+        }
+    }
+
+    *encoding = LEVEL_PACK_BITS;
+    return bitsSize;
+}
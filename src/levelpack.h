@@ -0,0 +1,72 @@
+/**
+ * Read only pack of hand made or pre-generated levels.
+ *
+ * The file is memory mapped as is: opening a pack only checks the header, so
+ * it costs the same for ten levels or ten thousand. A level is decoded on
+ * request straight into the tiles of a TileMap, and only its own pages are
+ * read from disk.
+ *
+ * File layout: LevelPackHeader, levelCount LevelPackEntry, then the encoded
+ * grids. Every grid is stored in the smaller of two encodings:
+ * - bits: one bit per tile in row major order, set for walls
+ * - rle: alternating runs of empty and wall tiles starting with empty, each
+ *   run length as a little endian base 128 varint
+ *
+ * Levels are built with the pack tool (src/pack.c).
+*/
+#ifndef LEVELPACK_H
+#define LEVELPACK_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "tilemap.h"
+
+#define LEVEL_PACK_MAGIC 0x314B5053 // "SPK1"
+
+typedef enum LevelPackEncoding
+{
+    LEVEL_PACK_BITS,
+    LEVEL_PACK_RLE,
+} LevelPackEncoding;
+
+typedef struct LevelPackHeader
+{
+    uint32_t magic;
+    uint32_t levelCount;
+} LevelPackHeader;
+
+typedef struct LevelPackEntry
+{
+    uint64_t offset;        // From the start of the file
+    uint32_t size;          // Encoded bytes
+    uint16_t rows;
+    uint16_t cols;
+    uint32_t encoding;      // LevelPackEncoding
+    uint32_t reserved;
+} LevelPackEntry;
+
+typedef struct LevelPack
+{
+    const LevelPackHeader *header;
+    const LevelPackEntry *entries;
+    void *mapping;
+    size_t size;
+#if defined(_WIN32)
+    void *file;
+    void *fileMapping;
+#endif
+} LevelPack;
+
+bool LevelPackOpen(LevelPack *pack, const char *path);
+void LevelPackClose(LevelPack *pack);
+int LevelPackGetCount(const LevelPack *pack);
+
+// False when the level does not exist, is corrupt or is not the size of the tile map
+bool LevelPackDecode(const LevelPack *pack, int index, TileMap *tileMap);
+
+// Worst case size of an encoded grid, for sizing the buffer given to LevelPackEncode
+size_t LevelPackGetMaxEncodedSize(int rows, int cols);
+size_t LevelPackEncode(const TileMap *tileMap, uint8_t *buffer, LevelPackEncoding *encoding);
+
+#endif
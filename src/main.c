@@ -13,12 +13,59 @@
 */
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include "stdio.h"
 #include "float.h"
 #include "stdlib.h"
+#include "string.h"
+#include "time.h"
+#include "tilemap.h"
+#include "sim.h"
+#include "path.h"
+#include "dstar.h"
+#include "hamilton.h"
+#include "bitgrid.h"
+#include "mcts.h"
+#include "clock.h"
+#include "zobrist.h"
+#include "neural.h"
+#include "solver.h"
+#include "level.h"
+#include "levelpack.h"
+#include "input.h"
+#include "triplebuffer.h"
+#include "snakebody.h"
+
+// Raylib is built on GLFW and exports it, only the calls needed to chain the
+// key callback, pump events on the main thread and render on another one
+typedef struct GLFWwindow GLFWwindow;
+typedef void (*GLFWkeyfun)(GLFWwindow *window, int key, int scancode, int action, int mods);
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow *window, GLFWkeyfun callback);
+double glfwGetTime(void);
+void glfwWaitEventsTimeout(double timeout);
+int glfwWindowShouldClose(GLFWwindow *window);
+void glfwMakeContextCurrent(GLFWwindow *window);
+void glfwSwapBuffers(GLFWwindow *window);
+
+#define GLFW_PRESS 1
 
-#define GAME_SNAKE_TAIL_MAX_LENGTH 64
 #define GAME_MAX_ITEMS 16
+#define GAME_SNAKE_MAX_CHANGES 8
+#define GAME_DIRTY_TILES 64         // Tile changes kept for the renderer, more between two frames redraw the board
+#define GAME_TAIL_BATCH_SPANS 256   // Tail quads reserved in the render batch at a time, well below its 8192
+#define GAME_NEURAL_WEIGHTS_PATH "assets/policy.nn"
+#define GAME_SOLVER_TABLE_PATH "assets/solver.tbl"
+#define GAME_LEVEL_PACK_PATH "assets/levels.pack"
+#define GAME_INPUT_QUEUE_SIZE 3     // Turns buffered ahead of the snake, bounds the input lag to 3 moves
+#define GAME_SIM_MAX_SLEEP 0.01     // Longest simulation sleep while the snake moves, item timers run at this rate
+#define GAME_DEFAULT_FPS 60
+#define GAME_FRAME_SPIN 0.001       // Last part of a frame wait spent spinning, sleeps overshoot by about that much
+#define GAME_INPUT_POLL_PERIOD 0.001 // Longest time between two event pumps on the main thread, 1 kHz
+#define GAME_PACING_REPORT 5        // Seconds between two frame pacing reports
+#define GAME_MIN_TILE_SIZE 20      // Pixels, boards that do not fit in the window at this size scroll with the head
+#define GAME_MAX_BOARD_TEXTURE 8192 // Pixels, larger boards are not cached for dirty rendering
+#define GAME_LEVEL_SCORE 50         // Points to unlock the next level
+#define GAME_TRANSITION_FRAMES 60   // Frames watched after a level switch
 
 typedef struct Timer
 {
@@ -26,20 +73,6 @@ typedef struct Timer
     double previousTime;
 } Timer;
 
-typedef enum TileValue
-{
-    TILE_EMPTY,
-    TILE_WALL,
-    TILE_PLAYER,
-} TileValue;
-
-typedef struct TilePosition
-{
-    int row;
-    int col;
-} TilePosition;
-
-
 typedef enum ItemType
 {
     ITEM_NONE,
@@ -59,22 +92,73 @@ typedef struct Item
     int scorePoints;
 } Item;
 
-typedef struct TileMap
+typedef enum ControlMode
+{
+    CONTROL_PLAYER,
+    CONTROL_AUTOPILOT,
+    CONTROL_HAMILTON,
+    CONTROL_MCTS,
+    CONTROL_NEURAL,
+    CONTROL_SOLVER,
+    CONTROL_MODE_COUNT,
+} ControlMode;
+
+const char *controlModeNames[CONTROL_MODE_COUNT] = {
+    "Player",
+    "Autopilot",
+    "Hamilton",
+    "Monte Carlo",
+    "Neural",
+    "Solver",
+};
+
+typedef struct InputTurn
 {
-    int rows;
-    int cols;
-    TileValue *tiles;
-    float tileWidth;
-    float tileHeight;
-} TileMap;
-
-typedef struct SnakeTail
+    int direction;  // SimDirection
+    double time;    // When the key event was delivered
+} InputTurn;
+
+// Turns pressed between two moves, one is used per move so quick turns are not lost
+typedef struct InputQueue
+{
+    InputTurn turns[GAME_INPUT_QUEUE_SIZE];
+    int first;
+    int count;
+
+    // Time from the key event to the move that used it
+    int moves;
+    double totalLatency;
+    double maxLatency;
+} InputQueue;
+
+typedef struct SnakeChange
 {
     TilePosition tilePosition;
-    Vector2 position;
-    float width;
-    float height;
-} SnakeTail;
+    int delta; // +1 when a segment entered the tile, -1 when it left
+} SnakeChange;
+
+typedef enum DirtyContent
+{
+    DIRTY_EMPTY,
+    DIRTY_BODY,
+    DIRTY_APPLE,
+} DirtyContent;
+
+typedef struct DirtyTile
+{
+    int cell;
+    DirtyContent content; // What the tile shows now
+} DirtyTile;
+
+// Tiles whose content changed, for the renderer to update its copy of the
+// board. The head and the shaded tail segments are drawn every frame and are
+// not part of the board.
+typedef struct DirtyTiles
+{
+    DirtyTile tiles[GAME_DIRTY_TILES]; // Ring of the last changes, change n is at n % GAME_DIRTY_TILES
+    uint64_t count;                    // Changes ever recorded
+    int redrawCount;                   // Bumped when the whole board changed
+} DirtyTiles;
 
 typedef struct Snake
 {
@@ -86,25 +170,156 @@ typedef struct Snake
     float headWidth;
     float headHeight;
 
-    SnakeTail tail[GAME_SNAKE_TAIL_MAX_LENGTH];
-    int tailLength;
+    SnakeBody body;    // Segments behind the head, one entry per turn
 
     float speed; // Tiles per second
     Timer moveTimer;
 
     bool hasMove;
+    TilePosition droppedTilePosition; // Left by the last segment on the last move, where it is drawn from
+
+    // Occupancy changes since the autopilot last read them, more than
+    // GAME_SNAKE_MAX_CHANGES means some were lost and the planner must resync
+    SnakeChange changes[GAME_SNAKE_MAX_CHANGES];
+    int changeCount;
+
+    uint64_t hash; // Zobrist keys of the head, body cells and pending growth
 } Snake;
 
+// Everything that depends on the walls of a level, built on the loader thread
+typedef struct GameLevel
+{
+    int number;
+    const char *name;       // Style of a generated level or "Pack"
+    bool isValid;           // False when the generator fell back to an empty level
+    TileMap tileMap;
+    SimTileMap *simTileMap;
+    BitGrid openTiles;      // Tiles without walls
+    HamiltonCycle hamilton;
+    bool hasHamilton;
+    Image image;            // One pixel per tile, uploaded to the GPU on the main thread
+    double buildTime;
+} GameLevel;
+
+// Builds the next level while the current one is played. The level slot
+// belongs to the thread while a request is pending and to the game once
+// isReady is set, so the buffers are never shared.
+typedef struct GameLevelLoader
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int requested;          // Level number to build, 0 when idle
+    bool isReady;
+    bool quit;
+
+    uint64_t seed;          // Level n is generated from seed + n
+    LevelGenerator generator;
+    LevelPack pack;         // Level n is pack level n - 1 when there is a pack, wrapping around
+    GameLevel level;
+} GameLevelLoader;
+
+// Everything a frame draws, copied from the game by the simulation thread
+typedef struct GameSnapshot
+{
+    Snake snake;
+    Item items[GAME_MAX_ITEMS];
+    int score;
+    int level;
+    const char *levelName;
+    const Color *levelPixels;   // Tile colors of the level, stable until the render thread has uploaded them
+    int eatCount;               // Eat sounds are played by the render thread
+    DirtyTiles dirtyTiles;
+    ControlMode controlMode;
+    bool isPaused;
+    bool isOver;
+} GameSnapshot;
+
+// Paces the render thread and measures what the frames cost
+typedef struct FramePacer
+{
+    double frameTime;           // Target seconds per frame, 0 draws as fast as possible
+    double nextFrame;
+    double frameDuration;       // Of the last frame, wait included
+    bool isWaitingEvents;       // Frames only follow simulation changes, the renderer sleeps until woken
+    pthread_mutex_t wakeMutex;
+    pthread_cond_t wake;
+    bool isWoken;               // A wake that came while the renderer was busy is kept for its next wait
+
+    // Since the last report
+    double reportStart;
+    double renderCpuStart;      // CPU seconds of the render thread
+    double processCpuStart;     // CPU seconds of every thread
+    double worstFrame;
+    double lastFrame;
+    int frames;
+} FramePacer;
+
 typedef struct Game
 {
     int viewportWidth;
     int viewportHeight;
 
     TileMap tileMap;
+    SimTileMap *simTileMap; // Shared with every cloned SimState
     Snake snake;
+    BitGrid snakeTiles;     // Collision grid, tiles under the body without the head
 
-    Item items[GAME_MAX_ITEMS];
+    InputRing inputRing;    // Key events from the window thread
+    InputQueue input;
 
+    Item items[GAME_MAX_ITEMS];
+    uint64_t itemHash; // Zobrist keys of the apple cells
+    DirtyTiles dirtyTiles;
+
+    PathFinder pathFinder;
+    DStarPlanner planner;
+    HamiltonCycle hamilton;
+    GameLevelLoader levelLoader;
+    int level;
+    const char *levelName;
+    int levelStartScore;
+    bool isLevelSkipped;    // N was pressed, switch as soon as the next level is ready
+    Image levelImage;       // Tile colors of the level, swapped with the loader like the tiles
+    BitGrid levelTiles;     // Tiles without walls
+    BitGrid openTiles;      // Level tiles minus the snake, rebuilt when needed
+    BitGrid reachedTiles;
+    Mcts mcts;
+    NeuralNet neuralNet;
+    bool hasNeuralNet;       // False when no weights were found, the neural mode uses the autopilot
+    SolverTable solverTable; // Perfect moves for tiny boards, empty when there is no table
+    int hamiltonWarmupMoves; // No shortcuts until the body is laid along the cycle
+    ControlMode controlMode;
+
+    // Simulation thread
+    pthread_t simThread;
+    pthread_mutex_t wakeMutex;  // The simulation sleeps on wake until a key, its next move or quit
+    pthread_cond_t wake;
+    atomic_bool quit;
+    bool wasIdlePublished;      // The last snapshot was paused or game over
+    uint64_t snapshotSignature; // Of the last published snapshot, unchanged state is not copied again
+    int eatCount;
+    int ticks;
+    double tickLateness;        // Sum and max of how late moves were on their schedule
+    double maxTickLateness;
+    double pauseTime;           // When the game was paused, the move timer skips the pause
+
+    // Render thread, it owns the GL context while the main thread pumps events
+    pthread_t renderThread;
+    FramePacer pacer;
+    GameSnapshot snapshots[3];
+    TripleBuffer snapshotBuffer;
+    atomic_int renderedLevel;   // Level whose pixels are on the GPU, the simulation waits for it before switching again
+    Camera2D camera;            // Follows the head on boards larger than the window
+    Texture2D tileTexture;      // Render cache of the tile map, one pixel per tile
+    bool isDirtyRendering;      // Only redraw the tiles that changed into boardTexture instead of the whole board
+    RenderTexture2D boardTexture;
+    uint64_t drawnDirtyCount;   // Dirty tiles and redraws already in boardTexture
+    int drawnRedrawCount;
+    int playedEatCount;
+    int transitionFrames;       // Frames left to watch after a level switch
+    float transitionWorstFrame;
     Sound eatSound;
 
     int score;
@@ -115,18 +330,6 @@ typedef struct Game
     bool isOver;
 } Game;
 
-bool GameIsTileValid(TileMap *tileMap, TilePosition tilePosition) {
-    return tilePosition.row >= 0 && tilePosition.row < tileMap->rows && tilePosition.col >= 0 && tilePosition.col < tileMap->cols;
-}
-
-int GameGetTileValue(TileMap *tileMap, TilePosition tilePosition) {
-    return tileMap->tiles[tilePosition.row * tileMap->cols + tilePosition.col];
-}
-
-void GameSetTileValue(TileMap *tileMap, TilePosition tilePosition, TileValue value) {
-    tileMap->tiles[tilePosition.row * tileMap->cols + tilePosition.col] = value;
-}
-
 void GameGetTileFromVector2(TileMap *tileMap, Vector2 pixelPosition, TilePosition *tilePosition) {
     tilePosition->row = pixelPosition.y / tileMap->tileHeight;
     tilePosition->col = pixelPosition.x / tileMap->tileWidth;
@@ -141,22 +344,33 @@ void GameGetMouseTile(TileMap *tileMap, TilePosition *tilePosition) {
     GameGetTileFromVector2(tileMap, GetMousePosition(), tilePosition);
 }
 
-bool GameIsTilePositionEqual(TilePosition tilePositionA, TilePosition tilePositionB) {
-    return tilePositionA.row == tilePositionB.row && tilePositionA.col == tilePositionB.col;
+int GameGetSimDirection(Vector2 direction) {
+    if (direction.x > 0) {
+        return SIM_RIGHT;
+    } else if (direction.x < 0) {
+        return SIM_LEFT;
+    } else if (direction.y > 0) {
+        return SIM_DOWN;
+    } else if (direction.y < 0) {
+        return SIM_UP;
+    }
+
+    return -1;
 }
 
-bool GameIsSnakeAtTile(Snake *snake, TilePosition tilePosition) {
-    if (GameIsTilePositionEqual(snake->tilePosition, tilePosition)) {
-        return true;
-    }
+TilePosition GameGetTilePosition(TileMap *tileMap, int cell) {
+    TilePosition tilePosition = {.row = cell / tileMap->cols, .col = cell % tileMap->cols};
+    return tilePosition;
+}
 
-    for (int i = 0; i < snake->tailLength; i++) {
-        if (GameIsTilePositionEqual(snake->tail[i].tilePosition, tilePosition)) {
-            return true;
-        }
-    }
+// Head and body segments, growth not laid out yet is stacked on the tail
+int GameGetSnakeLength(Snake *snake) {
+    return 1 + snake->body.length + snake->body.pendingGrowth;
+}
 
-    return false;
+bool GameIsSnakeAtTile(Game *game, TilePosition tilePosition) {
+    return GameIsTilePositionEqual(game->snake.tilePosition, tilePosition) ||
+        BitGridGet(&game->snakeTiles, GameGetTileIndex(&game->tileMap, tilePosition));
 }
 
 bool GameIsItemAtTile(Game *game, TilePosition tilePosition) {
@@ -181,7 +395,7 @@ bool GameGetRandomEmptyTile(Game *game, TilePosition *tilePosition) {
             continue;
         }
 
-        if (GameIsSnakeAtTile(&game->snake, newTilePosition) || GameIsItemAtTile(game, newTilePosition)) {
+        if (GameIsSnakeAtTile(game, newTilePosition) || GameIsItemAtTile(game, newTilePosition)) {
             continue;
         }
 
@@ -212,36 +426,89 @@ Item* GameCheckSnakeHitsItem(Game *game, Snake *snake) {
     return NULL;
 }
 
+void GameRecordSnakeChange(Snake *snake, TilePosition tilePosition, int delta) {
+    if (snake->changeCount < GAME_SNAKE_MAX_CHANGES) {
+        snake->changes[snake->changeCount].tilePosition = tilePosition;
+        snake->changes[snake->changeCount].delta = delta;
+        snake->changeCount++;
+    } else {
+        snake->changeCount = GAME_SNAKE_MAX_CHANGES + 1;
+    }
+}
+
+void GameRecordDirtyTile(DirtyTiles *dirtyTiles, TileMap *tileMap, TilePosition tilePosition, DirtyContent content) {
+    DirtyTile *tile = &dirtyTiles->tiles[dirtyTiles->count % GAME_DIRTY_TILES];
+
+    tile->cell = GameGetTileIndex(tileMap, tilePosition);
+    tile->content = content;
+    dirtyTiles->count++;
+}
+
+// Full snake hash from scratch, GameMoveSnake and GameGrowSnake keep snake->hash up to date incrementally
+uint64_t GameComputeSnakeHash(TileMap *tileMap, Snake *snake) {
+    uint64_t hash = ZobristKey(ZOBRIST_HEAD, GameGetTileIndex(tileMap, snake->tilePosition)) ^ ZobristGrowthKey(snake->body.pendingGrowth);
+    SnakeBodyCursor cursor;
+
+    SnakeBodyBegin(&cursor, &snake->body);
+
+    while (SnakeBodyNext(&cursor)) {
+        hash ^= ZobristKey(ZOBRIST_BODY, cursor.cell);
+    }
+
+    return hash;
+}
+
+// The new segment is laid out behind the tail on the next move
 void GameGrowSnake(Snake *snake) {
-    snake->tail[snake->tailLength].position.x = snake->tail[snake->tailLength - 1].position.x;
-    snake->tail[snake->tailLength].position.y = snake->tail[snake->tailLength - 1].position.y;
-    snake->tail[snake->tailLength].tilePosition.row = snake->tail[snake->tailLength - 1].tilePosition.row;
-    snake->tail[snake->tailLength].tilePosition.col = snake->tail[snake->tailLength - 1].tilePosition.col;
-    snake->tail[snake->tailLength].width = snake->tail[snake->tailLength - 1].width;
-    snake->tail[snake->tailLength].height = snake->tail[snake->tailLength - 1].height;
-    snake->tailLength += 1;
+    int pendingGrowth = snake->body.pendingGrowth;
 
-    printf("Snake grew %d\n", snake->tailLength);
+    snake->hash ^= ZobristGrowthKey(pendingGrowth) ^ ZobristGrowthKey(pendingGrowth + 1);
+    snake->body.pendingGrowth++;
+
+    printf("Snake grew %d\n", GameGetSnakeLength(snake) - 1);
 }
 
-void GameMoveSnake(TileMap *tileMap, Snake *snake, TilePosition tilePosition) {
-    TilePosition tailTilePosition = snake->tilePosition;
+void GameMoveSnake(Game *game, TilePosition tilePosition) {
+    TileMap *tileMap = &game->tileMap;
+    Snake *snake = &game->snake;
+    int oldHead = GameGetTileIndex(tileMap, snake->tilePosition);
+    int pendingGrowth = snake->body.pendingGrowth;
+    int leftCell = SnakeBodyMove(&snake->body, GameGetSimDirection(snake->direction));
+
+    snake->hash ^= ZobristKey(ZOBRIST_HEAD, oldHead) ^ ZobristKey(ZOBRIST_HEAD, GameGetTileIndex(tileMap, tilePosition));
+    snake->hash ^= ZobristKey(ZOBRIST_BODY, oldHead);
 
     snake->position.x = tilePosition.col * tileMap->tileWidth;
     snake->position.y = tilePosition.row * tileMap->tileHeight;
     snake->tilePosition.row = tilePosition.row;
     snake->tilePosition.col = tilePosition.col;
 
-    for (int i = 0; i < snake->tailLength; i++) {
-        SnakeTail *tail = &snake->tail[i];
-        TilePosition tempTilePosition = tail->tilePosition;
+    // Pending growth was laid out instead of the last segment leaving its tile
+    if (leftCell < 0) {
+        snake->hash ^= ZobristGrowthKey(pendingGrowth) ^ ZobristGrowthKey(pendingGrowth - 1);
+    } else {
+        snake->hash ^= ZobristKey(ZOBRIST_BODY, leftCell);
+    }
 
-        tail->position.x = tailTilePosition.col * tileMap->tileWidth;
-        tail->position.y = tailTilePosition.row * tileMap->tileHeight;
-        tail->tilePosition.row = tailTilePosition.row;
-        tail->tilePosition.col = tailTilePosition.col;
+    // Without a body the tile left is the old head, so it is cleared last
+    BitGridSet(&game->snakeTiles, oldHead);
+    GameRecordSnakeChange(snake, tilePosition, 1);
 
-        tailTilePosition = tempTilePosition;
+    if (leftCell >= 0) {
+        BitGridReset(&game->snakeTiles, leftCell);
+        GameRecordSnakeChange(snake, GameGetTilePosition(tileMap, leftCell), -1);
+    }
+
+    snake->droppedTilePosition = GameGetTilePosition(tileMap, leftCell >= 0 ? leftCell : snake->body.tail);
+
+    // On the board only the first unshaded segment moves in and the last one moves out
+    if (snake->body.length > GAME_SNAKE_SHADED_LENGTH) {
+        GameRecordDirtyTile(&game->dirtyTiles, tileMap,
+            GameGetTilePosition(tileMap, SnakeBodyGetCell(&snake->body, GAME_SNAKE_SHADED_LENGTH)), DIRTY_BODY);
+    }
+
+    if (leftCell >= 0) {
+        GameRecordDirtyTile(&game->dirtyTiles, tileMap, GameGetTilePosition(tileMap, leftCell), DIRTY_EMPTY);
     }
 
     if (!snake->hasMove) {
@@ -276,6 +543,8 @@ void GameSpawnItem(Game *game, ItemType type, TilePosition tilePosition) {
         item->lifeTime = 5;
         item->scorePoints = 5;
         game->appleSpawnCount++;
+        game->itemHash ^= ZobristKey(ZOBRIST_APPLE, GameGetTileIndex(&game->tileMap, tilePosition));
+        GameRecordDirtyTile(&game->dirtyTiles, &game->tileMap, tilePosition, DIRTY_APPLE);
 
         printf("Spawn apple [%d:%d]\n", tilePosition.row, tilePosition.col);
     }
@@ -307,6 +576,8 @@ void GameDespawnItem(Game *game, Item *item) {
     if (item->type == ITEM_APPLE) {
         game->appleSpawnCount--;
         game->appleLastDespawnTime = GetTime();
+        game->itemHash ^= ZobristKey(ZOBRIST_APPLE, GameGetTileIndex(&game->tileMap, item->tilePosition));
+        GameRecordDirtyTile(&game->dirtyTiles, &game->tileMap, item->tilePosition, DIRTY_EMPTY);
     }
 
     item->type = ITEM_NONE;
@@ -340,51 +611,145 @@ void GameUpdateItems(Game *game) {
     }
 }
 
-void GameDrawItems(Game *game) {
+void GameDrawItems(GameSnapshot *snapshot, Rectangle view) {
     for (int i = 0; i < GAME_MAX_ITEMS; i++) {
-        Item *item = &game->items[i];
+        Item *item = &snapshot->items[i];
+        Rectangle bounds = {item->position.x, item->position.y, item->width, item->height};
 
-        if (item->type == ITEM_APPLE) {
+        if (item->type == ITEM_APPLE && CheckCollisionRecs(bounds, view)) {
             DrawRectangle(item->position.x, item->position.y, item->width, item->height, YELLOW);
         }
     }
 }
 
-void GameDrawSnake(Snake *snake) {
+// Pixel position between the tile a segment moved from and the one it is on, across the board edge when it wrapped
+Vector2 GameLerpTile(TileMap *tileMap, TilePosition from, TilePosition to, float alpha) {
+    int dx = to.col - from.col;
+    int dy = to.row - from.row;
+
+    dx += dx > tileMap->cols / 2 ? -tileMap->cols : dx < -tileMap->cols / 2 ? tileMap->cols : 0;
+    dy += dy > tileMap->rows / 2 ? -tileMap->rows : dy < -tileMap->rows / 2 ? tileMap->rows : 0;
+
+    Vector2 position = {
+        .x = (to.col - dx * (1 - alpha)) * tileMap->tileWidth,
+        .y = (to.row - dy * (1 - alpha)) * tileMap->tileHeight
+    };
+
+    return position;
+}
+
+// Segment colors by index, the segments past the shaded ones use the last
+static Color snakeTailColors[GAME_SNAKE_SHADED_LENGTH + 1];
+
+void GameInitTailColors(void) {
+    for (int i = 0; i <= GAME_SNAKE_SHADED_LENGTH; i++) {
+        snakeTailColors[i] = ColorBrightness(GREEN, i * 0.5 / GAME_SNAKE_SHADED_LENGTH);
+    }
+}
+
+Color GameGetTailColor(int index) {
+    return snakeTailColors[index < GAME_SNAKE_SHADED_LENGTH ? index : GAME_SNAKE_SHADED_LENGTH];
+}
+
+Vector2 GameGetSnakeHeadPosition(TileMap *tileMap, Snake *snake, float alpha) {
+    TilePosition from = snake->body.length > 0
+        ? GameGetTilePosition(tileMap, SnakeBodyGetCell(&snake->body, 0))
+        : snake->droppedTilePosition;
+
+    return GameLerpTile(tileMap, from, snake->tilePosition, alpha);
+}
+
+// Column and row steps away from the head for each SimDirection
+static const int gameAwaySteps[4][2] = {{0, 1}, {-1, 0}, {0, -1}, {1, 0}};
+
+// Whether a span may show in the view. Segments are drawn up to one tile
+// from their own while they move.
+bool GameIsSpanVisible(TileMap *tileMap, SnakeBodySpan *span, Rectangle view) {
+    int direction = span->direction >= 0 ? span->direction : 0;
+    int firstCol = span->cell % tileMap->cols;
+    int firstRow = span->cell / tileMap->cols;
+    int lastCol = firstCol + gameAwaySteps[direction][0] * (span->count - 1);
+    int lastRow = firstRow + gameAwaySteps[direction][1] * (span->count - 1);
+
+    Rectangle bounds = {
+        .x = (fminf(firstCol, lastCol) - 1) * tileMap->tileWidth,
+        .y = (fminf(firstRow, lastRow) - 1) * tileMap->tileHeight,
+        .width = (abs(lastCol - firstCol) + 3) * tileMap->tileWidth,
+        .height = (abs(lastRow - firstRow) + 3) * tileMap->tileHeight
+    };
+
+    return CheckCollisionRecs(bounds, view);
+}
+
+// One quad covering the segments from first (nearest the head) to last, the
+// shading is blended from one end to the other
+void GameEmitTailRun(Vector2 first, Vector2 last, float width, float height, Color firstColor, Color lastColor) {
+    bool isVertical = first.x == last.x && first.y != last.y;
+    bool isReversed = isVertical ? first.y > last.y : first.x > last.x;
+    Color start = isReversed ? lastColor : firstColor; // Left or top end
+    Color end = isReversed ? firstColor : lastColor;
+    float left = fminf(first.x, last.x);
+    float top = fminf(first.y, last.y);
+    float right = fmaxf(first.x, last.x) + width;
+    float bottom = fmaxf(first.y, last.y) + height;
+
+    rlColor4ub(start.r, start.g, start.b, start.a);
+    rlVertex2f(left, top);
+
+    Color bottomLeft = isVertical ? end : start;
+    rlColor4ub(bottomLeft.r, bottomLeft.g, bottomLeft.b, bottomLeft.a);
+    rlVertex2f(left, bottom);
+
+    rlColor4ub(end.r, end.g, end.b, end.a);
+    rlVertex2f(right, bottom);
+
+    Color topRight = isVertical ? start : end;
+    rlColor4ub(topRight.r, topRight.g, topRight.b, topRight.a);
+    rlVertex2f(right, top);
+}
+
+// Alpha is how far the snake is from its last move to the next one, every
+// segment is drawn between its previous tile and its current one. The
+// previous tile of a segment is the current tile of the one behind it, so
+// nothing is stored per segment. Only the first segmentCount segments are
+// drawn, growth not laid out yet is hidden under the last one. Spans outside
+// the view are skipped whole, so a long body off screen costs its turns.
+void GameDrawSnake(TileMap *tileMap, Snake *snake, float alpha, int segmentCount, Rectangle view) {
+    Vector2 head = GameGetSnakeHeadPosition(tileMap, snake, alpha);
     float eyeRadius = (snake->headWidth + snake->headHeight) * 0.08;
     float eyePadding = 5;
     Color eyeColor = WHITE;
 
     Vector2 leftEyeCenter = {
-        .x = snake->position.x + eyeRadius + eyePadding,
-        .y = snake->headHeight / 2 + snake->position.x
+        .x = head.x + eyeRadius + eyePadding,
+        .y = snake->headHeight / 2 + head.x
     };
 
     Vector2 rightEyeCenter = {
-        .x = snake->position.x + snake->headWidth - eyeRadius - eyePadding,
-        .y = snake->headHeight / 2 + snake->position.x
+        .x = head.x + snake->headWidth - eyeRadius - eyePadding,
+        .y = snake->headHeight / 2 + head.x
     };
 
     if (snake->direction.x > 0) {
-        leftEyeCenter.x = snake->position.x + snake->headWidth - eyeRadius - eyePadding;
-        leftEyeCenter.y = snake->position.y + eyeRadius + eyePadding;
-        rightEyeCenter.x = snake->position.x + snake->headWidth - eyeRadius - eyePadding;
-        rightEyeCenter.y = snake->position.y + snake->headHeight - eyeRadius - eyePadding;
+        leftEyeCenter.x = head.x + snake->headWidth - eyeRadius - eyePadding;
+        leftEyeCenter.y = head.y + eyeRadius + eyePadding;
+        rightEyeCenter.x = head.x + snake->headWidth - eyeRadius - eyePadding;
+        rightEyeCenter.y = head.y + snake->headHeight - eyeRadius - eyePadding;
     } else if (snake->direction.x < 0) {
-        leftEyeCenter.x = snake->position.x + eyeRadius + eyePadding;
-        leftEyeCenter.y = snake->position.y + snake->headHeight - eyeRadius - eyePadding;
-        rightEyeCenter.x = snake->position.x + eyeRadius + eyePadding;
-        rightEyeCenter.y = snake->position.y + eyeRadius + eyePadding;
+        leftEyeCenter.x = head.x + eyeRadius + eyePadding;
+        leftEyeCenter.y = head.y + snake->headHeight - eyeRadius - eyePadding;
+        rightEyeCenter.x = head.x + eyeRadius + eyePadding;
+        rightEyeCenter.y = head.y + eyeRadius + eyePadding;
     } else if (snake->direction.y > 0) {
-        leftEyeCenter.x = snake->position.x + snake->headWidth - eyeRadius - eyePadding;
-        leftEyeCenter.y = snake->position.y + snake->headHeight - eyeRadius - eyePadding;
-        rightEyeCenter.x = snake->position.x + eyeRadius + eyePadding;
-        rightEyeCenter.y = snake->position.y + snake->headHeight - eyeRadius - eyePadding;
+        leftEyeCenter.x = head.x + snake->headWidth - eyeRadius - eyePadding;
+        leftEyeCenter.y = head.y + snake->headHeight - eyeRadius - eyePadding;
+        rightEyeCenter.x = head.x + eyeRadius + eyePadding;
+        rightEyeCenter.y = head.y + snake->headHeight - eyeRadius - eyePadding;
     } else if (snake->direction.y < 0) {
-        leftEyeCenter.x = snake->position.x + eyeRadius + eyePadding;
-        leftEyeCenter.y = snake->position.y + eyeRadius + eyePadding;
-        rightEyeCenter.x = snake->position.x + snake->headWidth - eyeRadius - eyePadding;
-        rightEyeCenter.y = snake->position.y + eyeRadius + eyePadding;
+        leftEyeCenter.x = head.x + eyeRadius + eyePadding;
+        leftEyeCenter.y = head.y + eyeRadius + eyePadding;
+        rightEyeCenter.x = head.x + snake->headWidth - eyeRadius - eyePadding;
+        rightEyeCenter.y = head.y + eyeRadius + eyePadding;
     }
 
     float eyeDotRadius = eyeRadius * 0.4;
@@ -401,14 +766,62 @@ void GameDrawSnake(Snake *snake) {
         .y = rightEyeCenter.y + (snake->lookDirection.y * (eyeRadius - eyeDotRadius - eyeDotPadding))
     };
 
-    // Draw tail
-    for (int i = 0; i < snake->tailLength; i++) {
-        SnakeTail *tail = &snake->tail[i];
-        DrawRectangle(tail->position.x, tail->position.y, tail->width, tail->height, ColorBrightness(GREEN, Clamp(i * 0.05, 0.0, 0.5)));
+    // Draw tail straight into the render batch, one quad per span of
+    // segments that moved the same way. Room is reserved a chunk of spans at
+    // a time, a full batch is flushed between two quads and keeps the quad
+    // mode and texture, so no body length can overflow it.
+    int reservedSpans = 0;
+    rlSetTexture(rlGetTextureIdDefault());
+    rlBegin(RL_QUADS);
+    rlTexCoord2f(0, 0);
+
+    float width = (int) tileMap->tileWidth;
+    float height = (int) tileMap->tileHeight;
+    SnakeBodyCursor cursor;
+    SnakeBodySpan span;
+
+    SnakeBodyBegin(&cursor, &snake->body);
+
+    while (SnakeBodyNextSpan(&cursor, segmentCount, GAME_SNAKE_SHADED_LENGTH, &span)) {
+        if (!GameIsSpanVisible(tileMap, &span, view)) {
+            continue;
+        }
+
+        TilePosition tilePosition = GameGetTilePosition(tileMap, span.cell);
+        Vector2 first;
+        Vector2 last;
+
+        // The last segment came from the dropped tile, or stayed in place when the snake grew
+        if (span.direction < 0) {
+            first = GameLerpTile(tileMap, snake->droppedTilePosition, tilePosition, alpha);
+            last = first;
+        } else {
+            int colStep = gameAwaySteps[span.direction][0];
+            int rowStep = gameAwaySteps[span.direction][1];
+
+            first.x = (tilePosition.col + colStep * (1 - alpha)) * tileMap->tileWidth;
+            first.y = (tilePosition.row + rowStep * (1 - alpha)) * tileMap->tileHeight;
+            last.x = first.x + colStep * (span.count - 1) * tileMap->tileWidth;
+            last.y = first.y + rowStep * (span.count - 1) * tileMap->tileHeight;
+        }
+
+        first = (Vector2) {(int) first.x, (int) first.y};
+        last = (Vector2) {(int) last.x, (int) last.y};
+
+        if (reservedSpans == 0) {
+            rlCheckRenderBatchLimit(4 * GAME_TAIL_BATCH_SPANS);
+            reservedSpans = GAME_TAIL_BATCH_SPANS;
+        }
+
+        reservedSpans--;
+        GameEmitTailRun(first, last, width, height, GameGetTailColor(span.first), GameGetTailColor(span.first + span.count - 1));
     }
 
+    rlEnd();
+    rlSetTexture(0);
+
     // Draw head
-    DrawRectangle(snake->position.x, snake->position.y, snake->headWidth, snake->headHeight, GREEN);
+    DrawRectangle(head.x, head.y, snake->headWidth, snake->headHeight, GREEN);
 
     // Draw eyes
     DrawCircle(leftEyeCenter.x, leftEyeCenter.y, eyeRadius, eyeColor);
@@ -419,23 +832,133 @@ void GameDrawSnake(Snake *snake) {
     DrawCircle(rightEyeDotCenter.x, rightEyeDotCenter.y, eyeDotRadius, eyeDotColor);
 }
 
-void GameDrawTileMap(TileMap *tileMap) {
-    Color even = {77, 77, 77, 255};
-    Color odd = {0, 0, 0, 255};
-    for (int col = 0; col < tileMap->cols; col++) {
-        for (int row = 0; row < tileMap->rows; row++) {
-            Color tileColor = (row + col) % 2 == 0 ? even : odd;
-            DrawRectangle(col * tileMap->tileWidth, row * tileMap->tileHeight, tileMap->tileWidth, tileMap->tileHeight, tileColor);
+Rectangle GameGetBoardBounds(TileMap *tileMap) {
+    Rectangle bounds = {0, 0, tileMap->cols * tileMap->tileWidth, tileMap->rows * tileMap->tileHeight};
+    return bounds;
+}
+
+// Only the tiles in the view are taken from the tile texture
+void GameDrawTileMap(Game *game, Rectangle view) {
+    TileMap *tileMap = &game->tileMap;
+    int firstCol = Clamp(floorf(view.x / tileMap->tileWidth), 0, tileMap->cols);
+    int firstRow = Clamp(floorf(view.y / tileMap->tileHeight), 0, tileMap->rows);
+    int lastCol = Clamp(ceilf((view.x + view.width) / tileMap->tileWidth), 0, tileMap->cols);
+    int lastRow = Clamp(ceilf((view.y + view.height) / tileMap->tileHeight), 0, tileMap->rows);
+    Rectangle source = {firstCol, firstRow, lastCol - firstCol, lastRow - firstRow};
+    Rectangle dest = {
+        .x = firstCol * tileMap->tileWidth,
+        .y = firstRow * tileMap->tileHeight,
+        .width = source.width * tileMap->tileWidth,
+        .height = source.height * tileMap->tileHeight
+    };
+    Vector2 origin = {0, 0};
+
+    DrawTexturePro(game->tileTexture, source, dest, origin, 0, WHITE);
+}
+
+void GameDrawBoardTile(Game *game, DirtyTile *tile) {
+    TileMap *tileMap = &game->tileMap;
+    Rectangle dest = {
+        .x = tile->cell % tileMap->cols * tileMap->tileWidth,
+        .y = tile->cell / tileMap->cols * tileMap->tileHeight,
+        .width = tileMap->tileWidth,
+        .height = tileMap->tileHeight
+    };
+
+    if (tile->content == DIRTY_EMPTY) {
+        Rectangle source = {tile->cell % tileMap->cols, tile->cell / tileMap->cols, 1, 1};
+        DrawTexturePro(game->tileTexture, source, dest, (Vector2) {0, 0}, 0, WHITE);
+    } else {
+        DrawRectangleRec(dest, tile->content == DIRTY_APPLE ? YELLOW : GameGetTailColor(GAME_SNAKE_SHADED_LENGTH));
+    }
+}
+
+// Brings boardTexture up to date with the snapshot, the whole board is only
+// drawn again after a restart, a level switch or when too many tiles changed
+// between two frames
+void GameUpdateBoard(Game *game, GameSnapshot *snapshot) {
+    DirtyTiles *dirtyTiles = &snapshot->dirtyTiles;
+
+    if (dirtyTiles->redrawCount == game->drawnRedrawCount && dirtyTiles->count == game->drawnDirtyCount) {
+        return;
+    }
+
+    BeginTextureMode(game->boardTexture);
+
+    if (dirtyTiles->redrawCount != game->drawnRedrawCount || dirtyTiles->count - game->drawnDirtyCount > GAME_DIRTY_TILES) {
+        Snake *snake = &snapshot->snake;
+
+        ClearBackground(BLACK);
+        GameDrawTileMap(game, GameGetBoardBounds(&game->tileMap));
+        GameDrawItems(snapshot, GameGetBoardBounds(&game->tileMap));
+
+        SnakeBodyCursor cursor;
+        SnakeBodyBegin(&cursor, &snake->body);
+
+        while (SnakeBodyNext(&cursor)) {
+            if (cursor.index >= GAME_SNAKE_SHADED_LENGTH) {
+                DirtyTile tile = {cursor.cell, DIRTY_BODY};
+                GameDrawBoardTile(game, &tile);
+            }
+        }
+    } else {
+        for (uint64_t i = game->drawnDirtyCount; i < dirtyTiles->count; i++) {
+            GameDrawBoardTile(game, &dirtyTiles->tiles[i % GAME_DIRTY_TILES]);
         }
     }
+
+    EndTextureMode();
+
+    game->drawnRedrawCount = dirtyTiles->redrawCount;
+    game->drawnDirtyCount = dirtyTiles->count;
+}
+
+void GameDrawBoard(Game *game, Rectangle view) {
+    Texture2D *texture = &game->boardTexture.texture;
+    view = GetCollisionRec(view, GameGetBoardBounds(&game->tileMap));
+
+    // Render textures are stored upside down
+    Rectangle source = {view.x, texture->height - view.y - view.height, view.width, -view.height};
+    DrawTextureRec(*texture, source, (Vector2) {view.x, view.y}, WHITE);
 }
 
-void GameDrawUI(Game *game) {
+// Keeps the head in the middle of the window, without showing past the board edges
+Rectangle GameUpdateCamera(Game *game, Vector2 head) {
+    TileMap *tileMap = &game->tileMap;
+    Rectangle bounds = GameGetBoardBounds(tileMap);
+    float halfWidth = game->viewportWidth / 2.0f;
+    float halfHeight = game->viewportHeight / 2.0f;
+
+    game->camera.offset = (Vector2) {halfWidth, halfHeight};
+    game->camera.target.x = roundf(Clamp(head.x + tileMap->tileWidth / 2, halfWidth, fmaxf(halfWidth, bounds.width - halfWidth)));
+    game->camera.target.y = roundf(Clamp(head.y + tileMap->tileHeight / 2, halfHeight, fmaxf(halfHeight, bounds.height - halfHeight)));
+    game->camera.rotation = 0;
+    game->camera.zoom = 1;
+
+    Rectangle view = {
+        .x = game->camera.target.x - halfWidth,
+        .y = game->camera.target.y - halfHeight,
+        .width = game->viewportWidth,
+        .height = game->viewportHeight
+    };
+
+    return view;
+}
+
+void GameDrawUI(Game *game, GameSnapshot *snapshot) {
     char scoreText[32];
-    sprintf(scoreText, "Score %d", game->score);
+    sprintf(scoreText, "Score %d", snapshot->score);
     DrawText(scoreText, 5, 5, 20, YELLOW);
 
-    if (game->isPaused) {
+    if (snapshot->controlMode != CONTROL_PLAYER) {
+        DrawText(controlModeNames[snapshot->controlMode], 5, 30, 20, YELLOW);
+    }
+
+    char levelText[64];
+    sprintf(levelText, "Level %d %s", snapshot->level, snapshot->levelName);
+    DrawText(levelText, game->viewportWidth - MeasureText(levelText, 20) - 5, 5, 20, YELLOW);
+
+    if (snapshot->isPaused) {
         // Overlay
         DrawRectangle(0, 0, game->viewportWidth, game->viewportHeight, ColorAlpha(BLACK, 0.5));
 
@@ -444,7 +967,7 @@ void GameDrawUI(Game *game) {
         int fontSize = 30;
         int textSize = MeasureText(text, fontSize);
         DrawText(text, game->viewportWidth / 2 - textSize / 2, game->viewportHeight / 2 - fontSize / 2, fontSize, WHITE);
-    } else if (game->isOver) {
+    } else if (snapshot->isOver) {
         // Overlay
         DrawRectangle(0, 0, game->viewportWidth, game->viewportHeight, ColorAlpha(BLACK, 0.5));
 
@@ -459,69 +982,326 @@ void GameDrawUI(Game *game) {
 void GameSnakeHitItem(Game *game, Item *item) {
     if (item->type == ITEM_APPLE) {
         game->score += item->scorePoints;
-        GameGrowSnake(&game->snake);
+        if (GameGetSnakeLength(&game->snake) - 1 < GAME_SNAKE_TAIL_MAX_LENGTH) {
+            GameGrowSnake(&game->snake);
+        }
+
         game->snake.speed += 1;
         GameDespawnItem(game, item);
-        PlaySound(game->eatSound);
+        game->eatCount++;
     }
 }
 
-bool GameSnakeHitItself(Snake *snake) {
+bool GameSnakeHitItself(Game *game) {
+    return BitGridGet(&game->snakeTiles, GameGetTileIndex(&game->tileMap, game->snake.tilePosition));
+}
 
-    for (int i = 0; i < snake->tailLength; i++) {
-        if (GameIsTilePositionEqual(snake->tilePosition, snake->tail[i].tilePosition)) {
-            return true;
+uint64_t GameComputeStateHash(Game *game) {
+    uint64_t hash = GameComputeSnakeHash(&game->tileMap, &game->snake);
+
+    for (int i = 0; i < GAME_MAX_ITEMS; i++) {
+        if (game->items[i].type == ITEM_APPLE) {
+            hash ^= ZobristKey(ZOBRIST_APPLE, GameGetTileIndex(&game->tileMap, game->items[i].tilePosition));
         }
     }
 
-    return false;
+    return hash ^ ZobristDirectionKey(GameGetSimDirection(game->snake.direction));
 }
 
-void GameUpdateSnake(Game *game) {
-    if (game->isPaused || game->isOver) {
-        return;
+// Same value as GameComputeStateHash and as SimGetHash on a cloned state with the same apples
+uint64_t GameGetStateHash(Game *game) {
+    return game->snake.hash ^ game->itemHash ^ ZobristDirectionKey(GameGetSimDirection(game->snake.direction));
+}
+
+void GameSetSimDirection(Snake *snake, int direction) {
+    Vector2 directions[] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+
+    if (direction >= 0) {
+        snake->direction = directions[direction];
+    }
+}
+
+// Drops turns that would not change the direction or reverse into the body, and turns past the queue size
+bool GameInputPush(InputQueue *input, Snake *snake, int direction, double time) {
+    int lastDirection = input->count > 0
+        ? input->turns[(input->first + input->count - 1) % GAME_INPUT_QUEUE_SIZE].direction
+        : GameGetSimDirection(snake->direction);
+
+    if (input->count == GAME_INPUT_QUEUE_SIZE || direction == lastDirection ||
+        (lastDirection >= 0 && direction == ((lastDirection + 2) & 3))) {
+        return false;
+    }
+
+    InputTurn *turn = &input->turns[(input->first + input->count) % GAME_INPUT_QUEUE_SIZE];
+    turn->direction = direction;
+    turn->time = time;
+    input->count++;
+
+    return true;
+}
+
+bool GameInputPop(InputQueue *input, InputTurn *turn) {
+    if (input->count == 0) {
+        return false;
     }
 
+    *turn = input->turns[input->first];
+    input->first = (input->first + 1) % GAME_INPUT_QUEUE_SIZE;
+    input->count--;
+
+    return true;
+}
+
+void GameInputReset(InputQueue *input) {
+    if (input->moves > 0) {
+        printf("Input latency: %d turns, %.1fms average, %.1fms worst\n",
+            input->moves, input->totalLatency / input->moves * 1000, input->maxLatency * 1000);
+    }
+
+    memset(input, 0, sizeof(InputQueue));
+}
+
+// Rebuilds the incremental planner from scratch, used when the goal moved or changes were lost
+void GameResetPlanner(Game *game, int goal) {
     Snake *snake = &game->snake;
+    TileMap *tileMap = &game->tileMap;
+    int occupiedCells[GAME_SNAKE_TAIL_MAX_LENGTH + 1];
+    int head = GameGetTileIndex(tileMap, snake->tilePosition);
 
-    snake->moveTimer.elapsedTime = GetTime() - snake->moveTimer.previousTime;
+    occupiedCells[0] = head;
+    int length = SnakeBodyGetCells(&snake->body, occupiedCells + 1);
 
-    if (IsKeyPressed(KEY_SPACE)) {
-        if (snake->tailLength < GAME_SNAKE_TAIL_MAX_LENGTH) {
-            GameGrowSnake(snake);
+    DStarReset(&game->planner, tileMap, occupiedCells, length + 1, head, goal);
+}
+
+// Keeps the move unless it leads into a pocket too small for the snake, then picks the roomiest move
+int GameAvoidTraps(Game *game, int direction) {
+    Snake *snake = &game->snake;
+    TileMap *tileMap = &game->tileMap;
+    int head = GameGetTileIndex(tileMap, snake->tilePosition);
+    int neededTiles = GameGetSnakeLength(snake);
+    SnakeBodyCursor cursor;
+
+    BitGridCopy(&game->openTiles, &game->levelTiles);
+    BitGridReset(&game->openTiles, head);
+    SnakeBodyBegin(&cursor, &snake->body);
+
+    // The last segment moves away before the head can reach it, unless the snake is growing
+    while (SnakeBodyNext(&cursor)) {
+        if (cursor.index < snake->body.length - 1 || snake->body.pendingGrowth > 0) {
+            BitGridReset(&game->openTiles, cursor.cell);
         }
     }
 
-    if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A)) {
-        snake->direction.x = -1;
-        snake->direction.y = 0;
+    if (direction >= 0 && BitGridFloodFill(&game->openTiles, SimNeighbor(tileMap, head, direction), &game->reachedTiles) >= neededTiles) {
+        return direction;
     }
 
-    if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D)) {
-        snake->direction.x = 1;
-        snake->direction.y = 0;
+    int bestDirection = direction;
+    int bestTiles = 0;
+
+    for (int candidate = SIM_UP; candidate <= SIM_LEFT; candidate++) {
+        int tiles = BitGridFloodFill(&game->openTiles, SimNeighbor(tileMap, head, candidate), &game->reachedTiles);
+
+        if (tiles > bestTiles) {
+            bestTiles = tiles;
+            bestDirection = candidate;
+        }
     }
 
-    if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_W)) {
-        snake->direction.x = 0;
-        snake->direction.y = -1;
+    return bestDirection;
+}
+
+// Points the snake along the shortest safe path to the nearest apple
+void GameUpdateAutopilot(Game *game) {
+    Snake *snake = &game->snake;
+    TileMap *tileMap = &game->tileMap;
+    int head = GameGetTileIndex(tileMap, snake->tilePosition);
+    int direction = -1;
+    Item *closestItem = GetClosestItem(game, snake->position);
+
+    if (closestItem != NULL) {
+        DStarPlanner *planner = &game->planner;
+        int goal = GameGetTileIndex(tileMap, closestItem->tilePosition);
+
+        if (goal != planner->goal || snake->changeCount > GAME_SNAKE_MAX_CHANGES) {
+            GameResetPlanner(game, goal);
+        } else {
+            for (int i = 0; i < snake->changeCount; i++) {
+                DStarSetOccupied(planner, GameGetTileIndex(tileMap, snake->changes[i].tilePosition), snake->changes[i].delta);
+            }
+
+            DStarMoveStart(planner, head);
+        }
+
+        snake->changeCount = 0;
+        direction = DStarPlan(planner);
+    }
+
+    // The incremental planner treats the whole body as walls, the full search
+    // knows when segments move away and may still find a way out
+    if (direction < 0) {
+        PathFinder *pathFinder = &game->pathFinder;
+        int bodyCells[GAME_SNAKE_TAIL_MAX_LENGTH];
+        int goals[GAME_MAX_ITEMS];
+        int goalCount = 0;
+        int length = SnakeBodyGetCells(&snake->body, bodyCells);
+
+        for (int i = 0; i < GAME_MAX_ITEMS; i++) {
+            if (game->items[i].type == ITEM_APPLE) {
+                goals[goalCount++] = GameGetTileIndex(tileMap, game->items[i].tilePosition);
+            }
+        }
+
+        PathFinderClearObstacles(pathFinder, tileMap);
+        PathFinderBlockSnake(pathFinder, head, bodyCells, length, snake->body.pendingGrowth);
+
+        direction = PathFinderSearch(pathFinder, head, goals, goalCount);
+
+        if (direction < 0) {
+            direction = PathFinderGetSafeDirection(pathFinder, head, GameGetSimDirection(snake->direction));
+        }
     }
 
-    if (IsKeyPressed(KEY_DOWN) || IsKeyPressed(KEY_S)) {
-        snake->direction.x = 0;
-        snake->direction.y = 1;
+    direction = GameAvoidTraps(game, direction);
+
+    GameSetSimDirection(snake, direction);
+}
+
+// Follows the Hamiltonian cycle built at level load, taking safe shortcuts to the apple
+void GameUpdateHamilton(Game *game) {
+    Snake *snake = &game->snake;
+    TileMap *tileMap = &game->tileMap;
+    int head = GameGetTileIndex(tileMap, snake->tilePosition);
+    int tail = snake->body.tail;
+    int apple = -1;
+    Item *closestItem = GetClosestItem(game, snake->position);
+
+    if (closestItem != NULL && game->hamiltonWarmupMoves == 0) {
+        apple = GameGetTileIndex(tileMap, closestItem->tilePosition);
     }
 
-    if (IsKeyPressed(KEY_KP_ADD)) {
-        snake->speed += 1;
+    if (game->hamiltonWarmupMoves > 0) {
+        game->hamiltonWarmupMoves--;
     }
 
-    if (IsKeyPressed(KEY_KP_SUBTRACT)) {
-        if (snake->speed > 1) {
-            snake->speed -= 1;
-        }
+    int direction = HamiltonGetDirection(&game->hamilton, head, tail, apple, GameGetSnakeLength(snake));
+
+    // Off the cycle, for example next to a wall, let the path finder steer
+    if (direction < 0) {
+        GameUpdateAutopilot(game);
+        return;
+    }
+
+    GameSetSimDirection(snake, direction);
+}
+
+// Copies the game into a compact SimState that can be forked cheaply with SimFork
+void GameCloneState(Game *game, SimState *state, uint64_t seed) {
+    Snake *snake = &game->snake;
+    TileMap *tileMap = &game->tileMap;
+    int head = GameGetTileIndex(tileMap, snake->tilePosition);
+    SnakeBodyCursor cursor;
+
+    state->tileMap = SimTileMapRetain(game->simTileMap);
+    state->head = head;
+    state->tail = head;
+    state->length = 0;
+    state->pendingGrowth = snake->body.pendingGrowth;
+    state->direction = GameGetSimDirection(snake->direction);
+    state->appleCell = -1;
+    state->score = game->score;
+    state->ticks = 0;
+    state->isOver = game->isOver;
+    state->rng = seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+    state->hash = 0;
+
+    // Both store every segment as the direction to the one before it
+    SnakeBodyBegin(&cursor, &snake->body);
+
+    while (SnakeBodyNext(&cursor)) {
+        SimAppendSegment(state, cursor.direction);
+    }
+
+    Item *closestItem = GetClosestItem(game, snake->position);
+
+    if (closestItem != NULL) {
+        state->appleCell = GameGetTileIndex(tileMap, closestItem->tilePosition);
+    }
+
+    state->hash = SimComputeHash(state);
+}
+
+// Searches the next move in the background until the move is due
+void GameStartMcts(Game *game) {
+    Snake *snake = &game->snake;
+    SimState state;
+    double budget = 1 / snake->speed - (GetTime() - snake->moveTimer.previousTime);
+
+    GameCloneState(game, &state, (uint64_t) (GetTime() * 1000) + 1);
+    MctsStart(&game->mcts, &state, budget > 0.001 ? budget : 0.001);
+    SimRelease(&state);
+}
+
+void GameUpdateMcts(Game *game) {
+    MctsStop(&game->mcts);
+
+    int direction = MctsGetMove(&game->mcts);
+
+    if (direction < 0) {
+        GameUpdateAutopilot(game);
+        return;
+    }
+
+    GameSetSimDirection(&game->snake, direction);
+}
+
+void GameUpdateNeural(Game *game) {
+    SimState state;
+    int direction = -1;
+
+    if (game->hasNeuralNet) {
+        GameCloneState(game, &state, 1);
+        direction = NeuralChooseMove(&game->neuralNet, &state);
+        SimRelease(&state);
+    }
+
+    // No weights or weights trained for another board size
+    if (direction < 0) {
+        GameUpdateAutopilot(game);
+        return;
+    }
+
+    GameSetSimDirection(&game->snake, direction);
+}
+
+void GameUpdateSolver(Game *game) {
+    SimState state;
+
+    GameCloneState(game, &state, 1);
+
+    int direction = SolverTableGetMove(&game->solverTable, &state);
+
+    SimRelease(&state);
+
+    // Not in the table: no apple on the board, a longer snake or another board size
+    if (direction < 0) {
+        GameUpdateAutopilot(game);
+        return;
+    }
+
+    GameSetSimDirection(&game->snake, direction);
+}
+
+void GameUpdateSnake(Game *game) {
+    if (game->isPaused || game->isOver) {
+        return;
     }
 
+    Snake *snake = &game->snake;
+
+    snake->moveTimer.elapsedTime = GetTime() - snake->moveTimer.previousTime;
+
     snake->lookDirection.x = snake->direction.x;
     snake->lookDirection.y = snake->direction.y;
 
@@ -533,11 +1313,35 @@ void GameUpdateSnake(Game *game) {
         snake->lookDirection.y = direction.y;
     }
 
+    if (snake->moveTimer.elapsedTime >= 1 / snake->speed) {
+        InputTurn turn;
+
+        if (game->controlMode == CONTROL_PLAYER && GameInputPop(&game->input, &turn)) {
+            double latency = GetTime() - turn.time;
+
+            GameSetSimDirection(snake, turn.direction);
+            game->input.moves++;
+            game->input.totalLatency += latency;
+            game->input.maxLatency = fmax(game->input.maxLatency, latency);
+        } else if (game->controlMode == CONTROL_AUTOPILOT) {
+            GameUpdateAutopilot(game);
+        } else if (game->controlMode == CONTROL_HAMILTON) {
+            GameUpdateHamilton(game);
+        } else if (game->controlMode == CONTROL_MCTS) {
+            GameUpdateMcts(game);
+        } else if (game->controlMode == CONTROL_NEURAL) {
+            GameUpdateNeural(game);
+        } else if (game->controlMode == CONTROL_SOLVER) {
+            GameUpdateSolver(game);
+        }
+    }
+
     if (snake->direction.x != 0 || snake->direction.y != 0) {
         double timeToNextMove = 1 / snake->speed;
 
         if (snake->moveTimer.elapsedTime >= timeToNextMove) {
             TilePosition targetTilePosition;
+            bool isScheduled = snake->hasMove; // The first move leaves a standstill, not a schedule
 
             GameGetTilePositionFromDirection(snake->direction, snake->tilePosition, &targetTilePosition);
 
@@ -553,15 +1357,20 @@ void GameUpdateSnake(Game *game) {
                 targetTilePosition.col = 0;
             }
 
-            // if (GameIsTileValid(&game->tileMap, targetTilePosition)) {
-            //     int targetTileValue = GameGetTileValue(&game->tileMap, targetTilePosition);
+            if (GameGetTileValue(&game->tileMap, targetTilePosition) == TILE_WALL) {
+                printf("Snake hit a wall\n");
+                game->isOver = true;
+            } else {
+                GameMoveSnake(game, targetTilePosition);
+            }
 
-            //     if (targetTileValue != TILE_WALL) {
-            //         GameMoveSnake(&game->tileMap, snake, targetTilePosition);
-            //     }
-            // }
+            if (isScheduled) {
+                double lateness = snake->moveTimer.elapsedTime - timeToNextMove;
 
-            GameMoveSnake(&game->tileMap, snake, targetTilePosition);
+                game->ticks++;
+                game->tickLateness += lateness;
+                game->maxTickLateness = fmax(game->maxTickLateness, lateness);
+            }
 
             snake->moveTimer.previousTime = GetTime();
         }
@@ -573,21 +1382,31 @@ void GameUpdateSnake(Game *game) {
         GameSnakeHitItem(game, hitItem);
     }
 
-    if (snake->hasMove && GameSnakeHitItself(snake)) {
+    if (snake->hasMove && GameSnakeHitItself(game)) {
         printf("Snakehit itself\n");
         game->isOver = true;
     }
+
+#ifdef GAME_DEBUG_HASH
+    if (GameGetStateHash(game) != GameComputeStateHash(game)) {
+        printf("State hash desync %016llx\n", (unsigned long long) GameGetStateHash(game));
+    }
+#endif
+
+    if (game->controlMode == CONTROL_MCTS && !game->mcts.isSearching && !game->isOver) {
+        GameStartMcts(game);
+    }
 }
 
 void GameRestart(Game *game) {
     TilePosition initTilePosition = {.row = 1, .col = 1};
 
     game->score = 0;
+    game->levelStartScore = 0;
     game->isOver = false;
     game->isPaused = false;
     game->snake.direction.x = 0;
     game->snake.direction.y = 0;
-    game->snake.tailLength = 1;
     game->snake.speed = 5; // Tiles per second
     game->snake.moveTimer.elapsedTime = 0;
     game->snake.moveTimer.previousTime = 0;
@@ -596,61 +1415,609 @@ void GameRestart(Game *game) {
     game->snake.tilePosition.row = initTilePosition.row;
     game->snake.tilePosition.col = initTilePosition.col;
     game->snake.hasMove = false;
+    game->snake.droppedTilePosition = initTilePosition;
+    game->snake.changeCount = GAME_SNAKE_MAX_CHANGES + 1;
+    game->hamiltonWarmupMoves = 0;
+    GameInputReset(&game->input);
+
+    if (game->ticks > 0) {
+        printf("Tick lateness: %d moves, %.2fms average, %.2fms worst\n",
+            game->ticks, game->tickLateness / game->ticks * 1000, game->maxTickLateness * 1000);
+    }
+
+    game->ticks = 0;
+    game->tickLateness = 0;
+    game->maxTickLateness = 0;
+
+    // The snake starts with one segment, laid out on the first move
+    SnakeBodyReset(&game->snake.body, GameGetTileIndex(&game->tileMap, initTilePosition));
+    game->snake.body.pendingGrowth = 1;
+    BitGridClear(&game->snakeTiles);
+
+    game->snake.hash = GameComputeSnakeHash(&game->tileMap, &game->snake);
+    game->dirtyTiles.redrawCount++;
+}
+
+static void GameBuildLevel(GameLevelLoader *loader, GameLevel *level, int number) {
+    Color even = {77, 77, 77, 255};
+    Color odd = {0, 0, 0, 255};
+    Color wall = {140, 95, 60, 255};
+    TileMap *tileMap = &level->tileMap;
+    int startCell = 1 * tileMap->cols + 1;
+    double start = ClockNow();
+
+    int packCount = LevelPackGetCount(&loader->pack);
+
+    level->number = number;
+
+    // Pack levels are checked when packed, validating again fills the open tiles
+    if (packCount > 0 && LevelPackDecode(&loader->pack, (number - 1) % packCount, tileMap) &&
+        LevelValidate(&loader->generator, tileMap, startCell)) {
+        level->name = "Pack";
+        level->isValid = true;
+    } else {
+        LevelStyle style = number % LEVEL_STYLE_COUNT;
+        level->name = levelStyleNames[style];
+        level->isValid = LevelGenerate(&loader->generator, tileMap, style, loader->seed + number, startCell);
+    }
+
+    BitGridCopy(&level->openTiles, &loader->generator.open);
+
+    // Clones still searching on the level before the last keep their copy alive
+    if (level->simTileMap != NULL) {
+        SimTileMapRelease(level->simTileMap);
+    }
 
-    for (int i = 0; i < GAME_SNAKE_TAIL_MAX_LENGTH; i++) {
-        game->snake.tail[i].width = game->tileMap.tileWidth;
-        game->snake.tail[i].height = game->tileMap.tileHeight;
-        game->snake.tail[i].position.x = game->snake.position.x;
-        game->snake.tail[i].position.y = game->snake.position.y;
-        game->snake.tail[i].tilePosition.row = initTilePosition.row;
-        game->snake.tail[i].tilePosition.col = initTilePosition.col;
+    level->simTileMap = SimTileMapCreate(tileMap);
+    level->hasHamilton = HamiltonBuild(&level->hamilton, tileMap, startCell);
+
+    Color *pixels = (Color*) level->image.data;
+
+    for (int row = 0; row < tileMap->rows; row++) {
+        for (int col = 0; col < tileMap->cols; col++) {
+            int cell = row * tileMap->cols + col;
+            pixels[cell] = tileMap->tiles[cell] == TILE_WALL ? wall : (row + col) % 2 == 0 ? even : odd;
+        }
     }
+
+    level->buildTime = ClockNow() - start;
 }
 
-void GameUpdate(Game *game) {
-    if (IsKeyPressed(KEY_SPACE)) {
-        if (!game->isOver) {
-            game->isPaused = !game->isPaused;
+static void* GameLevelLoaderRun(void *data) {
+    GameLevelLoader *loader = (GameLevelLoader*) data;
+
+    pthread_mutex_lock(&loader->mutex);
+
+    while (true) {
+        while (!loader->quit && loader->requested == 0) {
+            pthread_cond_wait(&loader->wake, &loader->mutex);
         }
+
+        if (loader->quit) {
+            break;
+        }
+
+        int number = loader->requested;
+        pthread_mutex_unlock(&loader->mutex);
+
+        GameBuildLevel(loader, &loader->level, number);
+
+        pthread_mutex_lock(&loader->mutex);
+        loader->requested = 0;
+        loader->isReady = true;
+        pthread_cond_broadcast(&loader->done);
+    }
+
+    pthread_mutex_unlock(&loader->mutex);
+
+    return NULL;
+}
+
+void GameLevelLoaderInit(GameLevelLoader *loader, int rows, int cols, uint64_t seed, const char *packPath) {
+    GameLevel *level = &loader->level;
+
+    level->tileMap.rows = rows;
+    level->tileMap.cols = cols;
+    level->tileMap.tileWidth = 1;
+    level->tileMap.tileHeight = 1;
+    level->tileMap.tiles = (TileValue*) calloc(rows * cols, sizeof(TileValue));
+    level->simTileMap = NULL;
+    level->image = GenImageColor(cols, rows, BLACK);
+    BitGridInit(&level->openTiles, rows, cols);
+    HamiltonInit(&level->hamilton, rows, cols);
+    LevelGeneratorInit(&loader->generator, rows, cols);
+
+    // Only maps the file, levels are decoded one at a time by the loader thread
+    if (LevelPackOpen(&loader->pack, packPath)) {
+        printf("Level pack %s: %d levels\n", packPath, LevelPackGetCount(&loader->pack));
+    }
+
+    loader->seed = seed;
+    loader->requested = 0;
+    loader->isReady = false;
+    loader->quit = false;
+
+    pthread_mutex_init(&loader->mutex, NULL);
+    pthread_cond_init(&loader->wake, NULL);
+    pthread_cond_init(&loader->done, NULL);
+    pthread_create(&loader->thread, NULL, GameLevelLoaderRun, loader);
+}
+
+void GameLevelLoaderFree(GameLevelLoader *loader) {
+    GameLevel *level = &loader->level;
+
+    pthread_mutex_lock(&loader->mutex);
+    loader->quit = true;
+    pthread_cond_broadcast(&loader->wake);
+    pthread_mutex_unlock(&loader->mutex);
+    pthread_join(loader->thread, NULL);
+
+    pthread_mutex_destroy(&loader->mutex);
+    pthread_cond_destroy(&loader->wake);
+    pthread_cond_destroy(&loader->done);
+
+    if (level->simTileMap != NULL) {
+        SimTileMapRelease(level->simTileMap);
     }
 
-    if (IsKeyPressed(KEY_ENTER)) {
-        if (game->isOver) {
-            GameRestart(game);
+    free(level->tileMap.tiles);
+    UnloadImage(level->image);
+    BitGridFree(&level->openTiles);
+    HamiltonFree(&level->hamilton);
+    LevelGeneratorFree(&loader->generator);
+    LevelPackClose(&loader->pack);
+}
+
+// Hands the level slot to the loader thread, it must not be touched until the level is ready
+void GameLevelLoaderRequest(GameLevelLoader *loader, int number) {
+    pthread_mutex_lock(&loader->mutex);
+    loader->isReady = false;
+    loader->requested = number;
+    pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->mutex);
+}
+
+bool GameLevelLoaderIsReady(GameLevelLoader *loader) {
+    pthread_mutex_lock(&loader->mutex);
+    bool isReady = loader->isReady;
+    pthread_mutex_unlock(&loader->mutex);
+
+    return isReady;
+}
+
+void GameLevelLoaderWait(GameLevelLoader *loader) {
+    pthread_mutex_lock(&loader->mutex);
+
+    while (!loader->isReady) {
+        pthread_cond_wait(&loader->done, &loader->mutex);
+    }
+
+    pthread_mutex_unlock(&loader->mutex);
+}
+
+// Swaps in the pre-built level and gives its old buffers to the loader for the level after it
+void GameSwitchLevel(Game *game) {
+    GameLevelLoader *loader = &game->levelLoader;
+    GameLevel *level = &loader->level;
+    double start = GetTime();
+
+    GameLevelLoaderWait(loader);
+    MctsStop(&game->mcts);
+
+    TileValue *tiles = game->tileMap.tiles;
+    game->tileMap.tiles = level->tileMap.tiles;
+    level->tileMap.tiles = tiles;
+
+    SimTileMap *simTileMap = game->simTileMap;
+    game->simTileMap = level->simTileMap;
+    level->simTileMap = simTileMap;
+
+    BitGrid levelTiles = game->levelTiles;
+    game->levelTiles = level->openTiles;
+    level->openTiles = levelTiles;
+
+    HamiltonCycle hamilton = game->hamilton;
+    game->hamilton = level->hamilton;
+    level->hamilton = hamilton;
+
+    // Uploaded by the render thread when it sees the new level
+    Image levelImage = game->levelImage;
+    game->levelImage = level->image;
+    level->image = levelImage;
+
+    game->level = level->number;
+    game->levelName = level->name;
+
+    if (!level->isValid) {
+        printf("No valid %s level, using an empty one\n", game->levelName);
+    }
+
+    if (!level->hasHamilton) {
+        printf("No hamiltonian cycle for this level\n");
+    }
+
+    printf("Level %d %s: %d free tiles, built in %.2fms\n", game->level, game->levelName,
+        BitGridCount(&game->levelTiles), level->buildTime * 1000);
+
+    GameLevelLoaderRequest(loader, game->level + 1);
+
+    // Apples may be under the new walls
+    for (int i = 0; i < GAME_MAX_ITEMS; i++) {
+        if (game->items[i].type != ITEM_NONE) {
+            GameDespawnItem(game, &game->items[i]);
         }
     }
 
+    // The score carries over to the next level
+    int score = game->score;
+    GameRestart(game);
+    game->score = score;
+    game->levelStartScore = score;
+
+    printf("Level switch took %.3fms\n", (GetTime() - start) * 1000);
+}
+
+// Key presses in the order they were delivered, turns go to the turn queue
+void GameHandleInput(Game *game) {
+    InputEvent event;
+
+    while (InputRingPop(&game->inputRing, &event)) {
+        int direction = -1;
+
+        if (event.key == KEY_SPACE) {
+            if (!game->isOver) {
+                game->isPaused = !game->isPaused;
+
+                if (game->isPaused) {
+                    game->pauseTime = GetTime();
+                } else {
+                    game->snake.moveTimer.previousTime += GetTime() - game->pauseTime;
+                }
+            }
+        } else if (event.key == KEY_ENTER) {
+            if (game->isOver) {
+                GameRestart(game);
+            }
+        } else if (event.key == KEY_N) {
+            game->isLevelSkipped = true;
+        } else if (event.key == KEY_TAB) {
+            game->controlMode = (game->controlMode + 1) % CONTROL_MODE_COUNT;
+            MctsStop(&game->mcts);
+            game->hamiltonWarmupMoves = GameGetSnakeLength(&game->snake);
+        } else if (event.key == KEY_KP_ADD) {
+            game->snake.speed += 1;
+        } else if (event.key == KEY_KP_SUBTRACT) {
+            if (game->snake.speed > 1) {
+                game->snake.speed -= 1;
+            }
+        } else if (event.key == KEY_LEFT || event.key == KEY_A) {
+            direction = SIM_LEFT;
+        } else if (event.key == KEY_RIGHT || event.key == KEY_D) {
+            direction = SIM_RIGHT;
+        } else if (event.key == KEY_UP || event.key == KEY_W) {
+            direction = SIM_UP;
+        } else if (event.key == KEY_DOWN || event.key == KEY_S) {
+            direction = SIM_DOWN;
+        }
+
+        // Turns pressed on the pause or game over screen are not played
+        if (direction >= 0 && game->controlMode == CONTROL_PLAYER && !game->isPaused && !game->isOver) {
+            GameInputPush(&game->input, &game->snake, direction, event.time);
+        }
+    }
+}
+
+void GameUpdate(Game *game) {
+    GameHandleInput(game);
+
+    // Only switch once the loader is done and the last level reached the GPU, so it never stalls a tick
+    bool isLevelDone = game->isLevelSkipped || (!game->isOver && game->score - game->levelStartScore >= GAME_LEVEL_SCORE);
+
+    if (isLevelDone && atomic_load(&game->renderedLevel) == game->level && GameLevelLoaderIsReady(&game->levelLoader)) {
+        game->isLevelSkipped = false;
+        GameSwitchLevel(game);
+    }
+
     GameUpdateItems(game);
     GameUpdateSnake(game);
 }
 
+// Ends the wait of a renderer that sleeps until woken, from any thread
+void GameFramePacerWake(FramePacer *pacer) {
+    pthread_mutex_lock(&pacer->wakeMutex);
+    pacer->isWoken = true;
+    pthread_cond_signal(&pacer->wake);
+    pthread_mutex_unlock(&pacer->wakeMutex);
+}
+
+// Copies the game into the back snapshot and publishes it, skipped when nothing visible changed
+void GamePublishSnapshot(Game *game) {
+    uint64_t signature = GameGetStateHash(game);
+    uint64_t fields[] = {game->score, game->level, game->eatCount, game->controlMode, game->isPaused, game->isOver,
+        game->dirtyTiles.count, game->dirtyTiles.redrawCount};
+
+    for (int i = 0; i < (int) (sizeof(fields) / sizeof(fields[0])); i++) {
+        signature = (signature ^ fields[i]) * 0x100000001B3ULL;
+    }
+
+    if (signature == game->snapshotSignature) {
+        return;
+    }
+
+    GameSnapshot *snapshot = &game->snapshots[TripleBufferGetBack(&game->snapshotBuffer)];
+
+    // The snapshot keeps its own runs, only the ones in use are copied
+    SnakeBody body = snapshot->snake.body;
+    snapshot->snake = game->snake;
+    snapshot->snake.body = body;
+    SnakeBodyCopy(&snapshot->snake.body, &game->snake.body);
+    memcpy(snapshot->items, game->items, sizeof(game->items));
+    snapshot->score = game->score;
+    snapshot->level = game->level;
+    snapshot->levelName = game->levelName;
+    snapshot->levelPixels = (const Color*) game->levelImage.data;
+    snapshot->eatCount = game->eatCount;
+    snapshot->dirtyTiles = game->dirtyTiles;
+    snapshot->controlMode = game->controlMode;
+    snapshot->isPaused = game->isPaused;
+    snapshot->isOver = game->isOver;
+
+    TripleBufferPublish(&game->snapshotBuffer);
+    game->snapshotSignature = signature;
+
+    // The render thread may be asleep until woken, a new pause or game over screen must still be drawn
+    bool isIdle = game->isPaused || game->isOver;
+
+    if (isIdle || game->wasIdlePublished) {
+        GameFramePacerWake(&game->pacer);
+    }
+
+    game->wasIdlePublished = isIdle;
+}
+
+// Sleeps until the next move is due or a key arrives, only keys wake it while paused or on the game over screen
+static void GameSimulationWait(Game *game) {
+    Snake *snake = &game->snake;
+    double wait = GAME_SIM_MAX_SLEEP;
+
+    if (snake->direction.x != 0 || snake->direction.y != 0) {
+        wait = fmin(wait, snake->moveTimer.previousTime + 1 / snake->speed - GetTime());
+    }
+
+    pthread_mutex_lock(&game->wakeMutex);
+
+    if (InputRingIsEmpty(&game->inputRing) && !atomic_load(&game->quit)) {
+        if (game->isPaused || game->isOver) {
+            pthread_cond_wait(&game->wake, &game->wakeMutex);
+        } else if (wait > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+
+            long long nanoseconds = deadline.tv_nsec + (long long) (wait * 1e9);
+            deadline.tv_sec += nanoseconds / 1000000000;
+            deadline.tv_nsec = nanoseconds % 1000000000;
+
+            pthread_cond_timedwait(&game->wake, &game->wakeMutex, &deadline);
+        }
+    }
+
+    pthread_mutex_unlock(&game->wakeMutex);
+}
+
+// Runs on its own clock whatever the render thread is doing
+static void* GameSimulationRun(void *data) {
+    Game *game = (Game*) data;
+
+    while (!atomic_load(&game->quit)) {
+        GameUpdate(game);
+        GamePublishSnapshot(game);
+        GameSimulationWait(game);
+    }
+
+    MctsStop(&game->mcts);
+
+    return NULL;
+}
+
+static double GameGetCpuTime(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void GameFramePacerInit(FramePacer *pacer, int fps) {
+    memset(pacer, 0, sizeof(FramePacer));
+    pacer->frameTime = fps > 0 ? 1.0 / fps : 0;
+    pacer->nextFrame = GetTime() + pacer->frameTime;
+    pacer->reportStart = GetTime();
+    pacer->lastFrame = pacer->reportStart;
+    pacer->renderCpuStart = GameGetCpuTime(CLOCK_THREAD_CPUTIME_ID);
+    pacer->processCpuStart = GameGetCpuTime(CLOCK_PROCESS_CPUTIME_ID);
+    pthread_mutex_init(&pacer->wakeMutex, NULL);
+    pthread_cond_init(&pacer->wake, NULL);
+}
+
+void GameFramePacerFree(FramePacer *pacer) {
+    pthread_mutex_destroy(&pacer->wakeMutex);
+    pthread_cond_destroy(&pacer->wake);
+}
+
+// While waiting, frames are only drawn after GameFramePacerWake
+void GameFramePacerSetWaiting(FramePacer *pacer, bool isWaitingEvents) {
+    if (isWaitingEvents != pacer->isWaitingEvents) {
+        pacer->isWaitingEvents = isWaitingEvents;
+
+        if (!isWaitingEvents) {
+            pacer->nextFrame = GetTime() + pacer->frameTime;
+        }
+    }
+}
+
+// Sleeps most of the time left in the frame and spins the rest, sleeping alone overshoots by up to a millisecond
+void GameFramePacerWait(FramePacer *pacer) {
+    double now = GetTime();
+
+    if (pacer->isWaitingEvents) {
+        pthread_mutex_lock(&pacer->wakeMutex);
+
+        while (!pacer->isWoken) {
+            pthread_cond_wait(&pacer->wake, &pacer->wakeMutex);
+        }
+
+        pacer->isWoken = false;
+        pthread_mutex_unlock(&pacer->wakeMutex);
+        now = GetTime();
+    } else if (pacer->frameTime > 0) {
+        double remaining = pacer->nextFrame - now;
+
+        if (remaining > GAME_FRAME_SPIN) {
+            WaitTime(remaining - GAME_FRAME_SPIN);
+        }
+
+        while ((now = GetTime()) < pacer->nextFrame) {}
+
+        // A frame that ran late restarts the schedule instead of rushing to catch up
+        pacer->nextFrame = fmax(pacer->nextFrame + pacer->frameTime, now);
+    }
+
+    // A frame that waited for events was idle, not slow
+    if (!pacer->isWaitingEvents) {
+        pacer->worstFrame = fmax(pacer->worstFrame, now - pacer->lastFrame);
+    }
+
+    pacer->frameDuration = now - pacer->lastFrame;
+    pacer->lastFrame = now;
+    pacer->frames++;
+
+    double elapsed = now - pacer->reportStart;
+
+    if (elapsed >= GAME_PACING_REPORT) {
+        double renderCpu = GameGetCpuTime(CLOCK_THREAD_CPUTIME_ID);
+        double processCpu = GameGetCpuTime(CLOCK_PROCESS_CPUTIME_ID);
+
+        printf("Frames: %.1f fps, %.2fms worst, render cpu %.2fms per frame, process cpu %.1f%%\n",
+            pacer->frames / elapsed, pacer->worstFrame * 1000, (renderCpu - pacer->renderCpuStart) / pacer->frames * 1000,
+            (processCpu - pacer->processCpuStart) / elapsed * 100);
+
+        pacer->reportStart = now;
+        pacer->renderCpuStart = renderCpu;
+        pacer->processCpuStart = processCpu;
+        pacer->worstFrame = 0;
+        pacer->frames = 0;
+    }
+}
+
 void GameDraw(Game *game) {
+    GameSnapshot *snapshot = &game->snapshots[TripleBufferAcquire(&game->snapshotBuffer)];
+
+    // Same size every level, the texture is only created once
+    if (snapshot->level != atomic_load(&game->renderedLevel)) {
+        UpdateTexture(game->tileTexture, snapshot->levelPixels);
+        atomic_store(&game->renderedLevel, snapshot->level);
+        game->transitionFrames = GAME_TRANSITION_FRAMES;
+        game->transitionWorstFrame = 0;
+    } else if (game->transitionFrames > 0) {
+        game->transitionWorstFrame = fmaxf(game->transitionWorstFrame, game->pacer.frameDuration);
+
+        if (--game->transitionFrames == 0) {
+            printf("Level %d transition: worst frame %.2fms over %d frames\n",
+                snapshot->level, game->transitionWorstFrame * 1000, GAME_TRANSITION_FRAMES);
+        }
+    }
+
+    if (snapshot->eatCount != game->playedEatCount) {
+        game->playedEatCount = snapshot->eatCount;
+        PlaySound(game->eatSound);
+    }
+
+    // The simulation stays on its tick rate, frames in between are interpolated
+    Snake *snake = &snapshot->snake;
+    float alpha = snake->hasMove ? Clamp((GetTime() - snake->moveTimer.previousTime) * snake->speed, 0, 1) : 1;
+
+    // Nothing moves on the pause and game over screens once the last move is drawn
+    GameFramePacerSetWaiting(&game->pacer, (snapshot->isPaused || snapshot->isOver) && alpha >= 1);
+
+    if (game->isDirtyRendering) {
+        GameUpdateBoard(game, snapshot);
+    }
+
+    Rectangle view = GameUpdateCamera(game, GameGetSnakeHeadPosition(&game->tileMap, snake, alpha));
+
     BeginDrawing();
 
     ClearBackground(BLACK);
+    BeginMode2D(game->camera);
+
+    if (game->isDirtyRendering) {
+        GameDrawBoard(game, view);
+        GameDrawSnake(&game->tileMap, snake, alpha, snake->body.length < GAME_SNAKE_SHADED_LENGTH ? snake->body.length : GAME_SNAKE_SHADED_LENGTH, view);
+    } else {
+        GameDrawTileMap(game, view);
+        GameDrawItems(snapshot, view);
+        GameDrawSnake(&game->tileMap, snake, alpha, snake->body.length, view);
+    }
+
+    EndMode2D();
+
+    GameDrawUI(game, snapshot);
+
+    // EndDrawing would also poll events, which GLFW only allows on the main thread
+    rlDrawRenderBatchActive();
+    glfwSwapBuffers((GLFWwindow*) GetWindowHandle());
+}
+
+// Draws frames with the GL context the main thread handed over
+static void* GameRenderRun(void *data) {
+    Game *game = (Game*) data;
+
+    glfwMakeContextCurrent((GLFWwindow*) GetWindowHandle());
+    game->pacer.renderCpuStart = GameGetCpuTime(CLOCK_THREAD_CPUTIME_ID);
+
+    while (!atomic_load(&game->quit)) {
+        GameDraw(game);
+        GameFramePacerWait(&game->pacer);
+    }
+
+    glfwMakeContextCurrent(NULL);
+
+    return NULL;
+}
+
+// GLFW only delivers events on the thread that created the window, the main
+// thread pumps them and key presses are taken from its callback, timestamped
+// when they arrive and handed to the simulation thread
+static Game *keyCallbackGame;
+static GLFWkeyfun gameRaylibKeyCallback;
 
-    GameDrawTileMap(&game->tileMap);
-    GameDrawItems(game);
-    GameDrawSnake(&game->snake);
+static void GameKeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (action == GLFW_PRESS) {
+        InputEvent event = {key, glfwGetTime()};
 
-    GameDrawUI(game);
+        if (InputRingPush(&keyCallbackGame->inputRing, event)) {
+            pthread_mutex_lock(&keyCallbackGame->wakeMutex);
+            pthread_cond_signal(&keyCallbackGame->wake);
+            pthread_mutex_unlock(&keyCallbackGame->wakeMutex);
+        }
+    }
 
-    EndDrawing();
+    gameRaylibKeyCallback(window, key, scancode, action, mods);
 }
 
-void GameInit(Game *game) {
+void GameInit(Game *game, int rows, int cols) {
     int windowWidth = 800;
     int windowHeight = 800;
 
     InitWindow(windowWidth, windowHeight, "Snake Game");
+
+    InputRingInit(&game->inputRing);
+    keyCallbackGame = game;
+    gameRaylibKeyCallback = glfwSetKeyCallback((GLFWwindow*) GetWindowHandle(), GameKeyCallback);
     InitAudioDevice();
+    GameInitTailColors();
 
     game->viewportWidth = windowWidth;
     game->viewportHeight = windowHeight;
 
-    int rows = 20;
-    int cols = 20;
-
     TileValue *tiles = (TileValue*) malloc(sizeof(TileValue) * rows * cols);
 
     for (int i = 0; i < rows * cols; i++) {
@@ -659,19 +2026,132 @@ void GameInit(Game *game) {
 
     game->tileMap.rows = rows;
     game->tileMap.cols = cols;
-    game->tileMap.tileWidth = windowWidth / cols;
-    game->tileMap.tileHeight = windowHeight / rows;
+    game->tileMap.tileWidth = windowWidth / cols > GAME_MIN_TILE_SIZE ? windowWidth / cols : GAME_MIN_TILE_SIZE;
+    game->tileMap.tileHeight = windowHeight / rows > GAME_MIN_TILE_SIZE ? windowHeight / rows : GAME_MIN_TILE_SIZE;
     game->eatSound = LoadSound("assets/eat.ogg");
     game->appleSpawnRate = 2;
     game->tileMap.tiles = tiles;
+    game->simTileMap = SimTileMapCreate(&game->tileMap);
     game->snake.headWidth = game->tileMap.tileWidth;
     game->snake.headHeight = game->tileMap.tileHeight;
 
-    GameRestart(game);
+    PathFinderInit(&game->pathFinder, rows, cols);
+    DStarInit(&game->planner, rows, cols);
+    HamiltonInit(&game->hamilton, rows, cols);
+
+    BitGridInit(&game->levelTiles, rows, cols);
+    BitGridInit(&game->openTiles, rows, cols);
+    BitGridInit(&game->reachedTiles, rows, cols);
+    BitGridInit(&game->snakeTiles, rows, cols);
+    SnakeBodyInit(&game->snake.body, rows, cols, 0);
+
+    // Leave one core for the simulation and render threads, input pumping barely uses one
+    MctsInit(&game->mcts, ClockGetCoreCount() - 1, 1 << 18);
+
+    game->hasNeuralNet = NeuralLoad(&game->neuralNet, GAME_NEURAL_WEIGHTS_PATH);
+
+    if (!game->hasNeuralNet) {
+        printf("No neural policy weights in %s, the neural mode uses the autopilot\n", GAME_NEURAL_WEIGHTS_PATH);
+    }
+
+    if (!SolverTableOpen(&game->solverTable, GAME_SOLVER_TABLE_PATH)) {
+        printf("No solver table in %s, the solver mode uses the autopilot\n", GAME_SOLVER_TABLE_PATH);
+    } else if (game->solverTable.header->rows != (uint32_t) rows || game->solverTable.header->cols != (uint32_t) cols) {
+        printf("The solver table is for %ux%u boards, start the game with --size %u\n",
+            game->solverTable.header->rows, game->solverTable.header->cols, game->solverTable.header->rows);
+    }
+
+    uint64_t levelSeed = ((uint64_t) GetRandomValue(0, INT32_MAX) << 32) | (uint64_t) GetRandomValue(0, INT32_MAX);
+
+    game->levelImage = GenImageColor(cols, rows, BLACK);
+    GameLevelLoaderInit(&game->levelLoader, rows, cols, levelSeed, GAME_LEVEL_PACK_PATH);
+    GameLevelLoaderRequest(&game->levelLoader, 1);
+    GameSwitchLevel(game);
+
+    game->tileTexture = LoadTextureFromImage(game->levelImage);
+    Rectangle bounds = GameGetBoardBounds(&game->tileMap);
+
+    if (bounds.width <= GAME_MAX_BOARD_TEXTURE && bounds.height <= GAME_MAX_BOARD_TEXTURE) {
+        game->boardTexture = LoadRenderTexture(bounds.width, bounds.height);
+    }
+
+    game->drawnRedrawCount = -1;
+    atomic_init(&game->renderedLevel, game->level);
+
+    TripleBufferInit(&game->snapshotBuffer);
+    GamePublishSnapshot(game);
+    TripleBufferAcquire(&game->snapshotBuffer);
+
+    pthread_mutex_init(&game->wakeMutex, NULL);
+    pthread_cond_init(&game->wake, NULL);
+    atomic_init(&game->quit, false);
+}
+
+// Starts the simulation and the render thread, the GL context moves to the
+// render thread and the calling thread is left to pump window events
+void GameStart(Game *game, int fps) {
+    GameFramePacerInit(&game->pacer, fps);
+    pthread_create(&game->simThread, NULL, GameSimulationRun, game);
+
+    glfwMakeContextCurrent(NULL);
+    pthread_create(&game->renderThread, NULL, GameRenderRun, game);
+}
+
+// Window events are taken as soon as they arrive and at least every
+// GAME_INPUT_POLL_PERIOD, however long the render thread takes for a frame
+void GamePumpEvents(void) {
+    GLFWwindow *window = (GLFWwindow*) GetWindowHandle();
+
+    while (!glfwWindowShouldClose(window)) {
+        glfwWaitEventsTimeout(GAME_INPUT_POLL_PERIOD);
+    }
 }
 
 void GameExit(Game *game) {
+    pthread_mutex_lock(&game->wakeMutex);
+    atomic_store(&game->quit, true);
+    pthread_cond_signal(&game->wake);
+    pthread_mutex_unlock(&game->wakeMutex);
+    GameFramePacerWake(&game->pacer);
+    pthread_join(game->simThread, NULL);
+    pthread_join(game->renderThread, NULL);
+    pthread_mutex_destroy(&game->wakeMutex);
+    pthread_cond_destroy(&game->wake);
+    GameFramePacerFree(&game->pacer);
+
+    // Back from the render thread for the unloads and CloseWindow
+    glfwMakeContextCurrent((GLFWwindow*) GetWindowHandle());
+
     free(game->tileMap.tiles);
+    SimTileMapRelease(game->simTileMap);
+    PathFinderFree(&game->pathFinder);
+    DStarFree(&game->planner);
+    HamiltonFree(&game->hamilton);
+    BitGridFree(&game->levelTiles);
+    BitGridFree(&game->openTiles);
+    BitGridFree(&game->reachedTiles);
+    BitGridFree(&game->snakeTiles);
+    SnakeBodyFree(&game->snake.body);
+
+    for (int i = 0; i < 3; i++) {
+        SnakeBodyFree(&game->snapshots[i].snake.body);
+    }
+
+    GameLevelLoaderFree(&game->levelLoader);
+    UnloadTexture(game->tileTexture);
+
+    if (game->boardTexture.id != 0) {
+        UnloadRenderTexture(game->boardTexture);
+    }
+
+    UnloadImage(game->levelImage);
+    MctsFree(&game->mcts);
+
+    if (game->hasNeuralNet) {
+        NeuralFree(&game->neuralNet);
+    }
+
+    SolverTableClose(&game->solverTable);
 
     CloseWindow();
     CloseAudioDevice();
@@ -679,14 +2159,54 @@ void GameExit(Game *game) {
 
 static Game game;
 
-int main(void) {
-    GameInit(&game);
+// Usage: ./build/game [options]
+//   --size N   board size, 4 to 1000 (default 20), tiny boards are for the
+//              solver table, boards over 40 scroll with the head
+//   --fps N    frames per second, 0 for as many as possible (default 60)
+//   --render M full or dirty, dirty only redraws the tiles that changed and
+//              keeps the whole board in a texture (default full)
+int main(int argc, char **argv) {
+    int size = 20;
+    int fps = GAME_DEFAULT_FPS;
+    const char *render = "full";
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--size") == 0) {
+            size = atoi(value);
+            size = size < 4 ? 4 : size > 1000 ? 1000 : size;
+        } else if (strcmp(argv[i], "--fps") == 0) {
+            fps = atoi(value);
+        } else if (strcmp(argv[i], "--render") == 0) {
+            render = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+
+        i++;
+    }
+
+    if (fps < 0 || (strcmp(render, "full") != 0 && strcmp(render, "dirty") != 0)) {
+        fprintf(stderr, "Invalid options\n");
+        return 1;
+    }
+
+    GameInit(&game, size, size);
+    game.isDirtyRendering = strcmp(render, "dirty") == 0;
 
-    while (!WindowShouldClose()) {
-        GameUpdate(&game);
-        GameDraw(&game);
+    if (game.isDirtyRendering && game.boardTexture.id == 0) {
+        printf("The board is too large to cache, using full rendering\n");
+        game.isDirtyRendering = false;
     }
 
+    // The simulation and the frames run on their own threads, this one only takes input
+    GameStart(&game, fps);
+    GamePumpEvents();
     GameExit(&game);
 
     return 0;
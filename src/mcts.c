@@ -0,0 +1,307 @@
+#include "mcts.h"
+#include "clock.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+
+static void MctsResetNode(MctsNode *node) {
+    for (int i = 0; i < 4; i++) {
+        atomic_store_explicit(&node->children[i], 0, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&node->visits, 0, memory_order_relaxed);
+    atomic_store_explicit(&node->value, 0, memory_order_relaxed);
+}
+
+static bool MctsIsReverse(const SimState *state, int direction) {
+    return state->length > 0 && state->direction >= 0 && direction == ((state->direction + 2) & 3);
+}
+
+// Random moves that avoid the body when they can, heading for the apple now and then
+static int MctsRolloutMove(SimState *state, uint64_t *rng) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int moves[4];
+    int moveCount = 0;
+
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        if (!MctsIsReverse(state, direction) && !SimIsBodyAt(state, SimNeighbor(tileMap, state->head, direction))) {
+            moves[moveCount++] = direction;
+        }
+    }
+
+    if (moveCount == 0) {
+        return state->direction >= 0 ? state->direction : SIM_RIGHT;
+    }
+
+    if (state->appleCell >= 0 && (SimRandom(rng) & 3) != 0) {
+        for (int i = 0; i < moveCount; i++) {
+            if (SimNeighbor(tileMap, state->head, moves[i]) == state->appleCell) {
+                return moves[i];
+            }
+        }
+    }
+
+    return moves[SimRandom(rng) % moveCount];
+}
+
+// Dying scores 0, surviving 0.5 and eating early pushes it towards 1
+static double MctsReward(const SimState *state, int startScore, int firstEatTick) {
+    if (state->isOver) {
+        return 0;
+    }
+
+    if (state->score > startScore) {
+        return 0.5 + 0.5 * pow(0.97, firstEatTick);
+    }
+
+    return 0.5;
+}
+
+static void MctsIterate(Mcts *mcts, SimState *state, uint64_t *rng) {
+    int path[MCTS_MAX_DEPTH + 1];
+    int pathLength = 0;
+    int node = 0;
+    int startScore = mcts->root.score;
+    int firstEatTick = -1;
+
+    SimFork(state, &mcts->root);
+    path[pathLength++] = node;
+    atomic_fetch_add_explicit(&mcts->nodes[node].visits, 1, memory_order_relaxed);
+
+    // Selection and expansion
+    while (pathLength <= MCTS_MAX_DEPTH && !state->isOver) {
+        MctsNode *current = &mcts->nodes[node];
+        int parentVisits = atomic_load_explicit(&current->visits, memory_order_relaxed);
+        int bestDirection = -1;
+        int bestChild = 0;
+        double bestScore = -1;
+
+        for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+            if (MctsIsReverse(state, direction)) {
+                continue;
+            }
+
+            int child = atomic_load_explicit(&current->children[direction], memory_order_acquire);
+
+            if (child == 0) {
+                bestDirection = direction;
+                bestChild = 0;
+                break;
+            }
+
+            int visits = atomic_load_explicit(&mcts->nodes[child].visits, memory_order_relaxed);
+            double value = (double) atomic_load_explicit(&mcts->nodes[child].value, memory_order_relaxed) / MCTS_VALUE_SCALE;
+            double score = visits == 0 ? 2 : value / visits + 0.7 * sqrt(log(parentVisits + 1) / visits);
+
+            if (score > bestScore) {
+                bestScore = score;
+                bestDirection = direction;
+                bestChild = child;
+            }
+        }
+
+        int score = state->score;
+        SimStep(state, bestDirection);
+
+        if (state->score > score && firstEatTick < 0) {
+            firstEatTick = pathLength;
+        }
+
+        if (bestChild == 0) {
+            // Claim a node only while the pool has one left so nodeCount never
+            // passes the capacity. Once full, keep the tree as it is and just
+            // roll out from here
+            int index = atomic_load_explicit(&mcts->nodeCount, memory_order_relaxed);
+
+            while (index < mcts->nodeCapacity && !atomic_compare_exchange_weak_explicit(&mcts->nodeCount, &index, index + 1, memory_order_relaxed, memory_order_relaxed)) {}
+
+            if (index >= mcts->nodeCapacity) {
+                break;
+            }
+
+            MctsResetNode(&mcts->nodes[index]);
+
+            int expected = 0;
+
+            if (atomic_compare_exchange_strong_explicit(&current->children[bestDirection], &expected, index, memory_order_acq_rel, memory_order_acquire)) {
+                bestChild = index;
+            } else {
+                bestChild = expected; // Another worker expanded it first
+            }
+
+            atomic_fetch_add_explicit(&mcts->nodes[bestChild].visits, 1, memory_order_relaxed);
+            path[pathLength++] = bestChild;
+            break;
+        }
+
+        atomic_fetch_add_explicit(&mcts->nodes[bestChild].visits, 1, memory_order_relaxed);
+        path[pathLength++] = bestChild;
+        node = bestChild;
+    }
+
+    // Rollout
+    for (int depth = 0; depth < MCTS_ROLLOUT_DEPTH && !state->isOver; depth++) {
+        int score = state->score;
+        SimStep(state, MctsRolloutMove(state, rng));
+
+        if (state->score > score && firstEatTick < 0) {
+            firstEatTick = pathLength + depth;
+        }
+    }
+
+    long long reward = MctsReward(state, startScore, firstEatTick) * MCTS_VALUE_SCALE;
+
+    for (int i = 0; i < pathLength; i++) {
+        atomic_fetch_add_explicit(&mcts->nodes[path[i]].value, reward, memory_order_relaxed);
+    }
+
+    SimRelease(state);
+}
+
+static void* MctsWorker(void *data) {
+    Mcts *mcts = (Mcts*) data;
+    SimState *state = (SimState*) malloc(sizeof(SimState));
+    uint64_t rng = (uint64_t) (uintptr_t) state ^ 0x9E3779B97F4A7C15ULL;
+    int lastSearchId = 0;
+
+    pthread_mutex_lock(&mcts->mutex);
+
+    while (true) {
+        while (!mcts->quit && mcts->searchId == lastSearchId) {
+            pthread_cond_wait(&mcts->wake, &mcts->mutex);
+        }
+
+        if (mcts->quit) {
+            break;
+        }
+
+        // The deadline is written under the mutex before the wake, so copy it here
+        double deadline = mcts->deadline;
+        lastSearchId = mcts->searchId;
+        mcts->activeWorkers++;
+        pthread_mutex_unlock(&mcts->mutex);
+
+        long long iterations = 0;
+
+        while (atomic_load_explicit(&mcts->running, memory_order_acquire) && ClockNow() < deadline) {
+            MctsIterate(mcts, state, &rng);
+            iterations++;
+        }
+
+        atomic_fetch_add_explicit(&mcts->iterations, iterations, memory_order_relaxed);
+
+        pthread_mutex_lock(&mcts->mutex);
+        mcts->activeWorkers--;
+
+        if (mcts->activeWorkers == 0) {
+            pthread_cond_broadcast(&mcts->idle);
+        }
+    }
+
+    pthread_mutex_unlock(&mcts->mutex);
+    free(state);
+
+    return NULL;
+}
+
+void MctsInit(Mcts *mcts, int threadCount, int nodeCapacity) {
+    mcts->threadCount = threadCount > 0 ? threadCount : 1;
+    mcts->threads = (pthread_t*) malloc(sizeof(pthread_t) * mcts->threadCount);
+    mcts->searchId = 0;
+    mcts->activeWorkers = 0;
+    mcts->quit = false;
+    mcts->isSearching = false;
+    mcts->deadline = 0;
+    mcts->root.tileMap = NULL;
+    mcts->nodes = (MctsNode*) malloc(sizeof(MctsNode) * nodeCapacity);
+    mcts->nodeCapacity = nodeCapacity;
+    atomic_init(&mcts->running, false);
+    atomic_init(&mcts->nodeCount, 0);
+    atomic_init(&mcts->iterations, 0);
+    pthread_mutex_init(&mcts->mutex, NULL);
+    pthread_cond_init(&mcts->wake, NULL);
+    pthread_cond_init(&mcts->idle, NULL);
+
+    for (int i = 0; i < mcts->threadCount; i++) {
+        pthread_create(&mcts->threads[i], NULL, MctsWorker, mcts);
+    }
+}
+
+void MctsFree(Mcts *mcts) {
+    MctsStop(mcts);
+
+    pthread_mutex_lock(&mcts->mutex);
+    mcts->quit = true;
+    pthread_cond_broadcast(&mcts->wake);
+    pthread_mutex_unlock(&mcts->mutex);
+
+    for (int i = 0; i < mcts->threadCount; i++) {
+        pthread_join(mcts->threads[i], NULL);
+    }
+
+    SimRelease(&mcts->root);
+    pthread_mutex_destroy(&mcts->mutex);
+    pthread_cond_destroy(&mcts->wake);
+    pthread_cond_destroy(&mcts->idle);
+    free(mcts->threads);
+    free(mcts->nodes);
+}
+
+// Searches from root in the background until the budget (seconds) runs out or MctsStop is called
+void MctsStart(Mcts *mcts, const SimState *root, double budget) {
+    MctsStop(mcts);
+
+    SimRelease(&mcts->root);
+    SimFork(&mcts->root, root);
+    MctsResetNode(&mcts->nodes[0]);
+    atomic_store_explicit(&mcts->nodeCount, 1, memory_order_relaxed);
+    atomic_store_explicit(&mcts->iterations, 0, memory_order_relaxed);
+    mcts->isSearching = true;
+
+    pthread_mutex_lock(&mcts->mutex);
+    mcts->deadline = ClockNow() + budget;
+    atomic_store_explicit(&mcts->running, true, memory_order_release);
+    mcts->searchId++;
+    pthread_cond_broadcast(&mcts->wake);
+    pthread_mutex_unlock(&mcts->mutex);
+}
+
+// Workers notice within one iteration, which is a few microseconds
+void MctsStop(Mcts *mcts) {
+    atomic_store_explicit(&mcts->running, false, memory_order_release);
+
+    pthread_mutex_lock(&mcts->mutex);
+
+    while (mcts->activeWorkers > 0) {
+        pthread_cond_wait(&mcts->idle, &mcts->mutex);
+    }
+
+    pthread_mutex_unlock(&mcts->mutex);
+    mcts->isSearching = false;
+}
+
+// Most visited move from the root, -1 when nothing was searched
+int MctsGetMove(Mcts *mcts) {
+    if (mcts->root.tileMap == NULL) {
+        return -1;
+    }
+
+    MctsNode *root = &mcts->nodes[0];
+    int bestDirection = -1;
+    int bestVisits = 0;
+
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        int child = atomic_load_explicit(&root->children[direction], memory_order_acquire);
+
+        if (child != 0) {
+            int visits = atomic_load_explicit(&mcts->nodes[child].visits, memory_order_relaxed);
+
+            if (visits > bestVisits) {
+                bestVisits = visits;
+                bestDirection = direction;
+            }
+        }
+    }
+
+    return bestDirection;
+}
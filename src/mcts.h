@@ -0,0 +1,58 @@
+/**
+ * Monte Carlo tree search over SimState running on a pool of worker threads.
+ *
+ * All workers share one tree. Visits and values are updated with atomics and
+ * a visit is counted on the way down, before the rollout result is known,
+ * which acts as a virtual loss and spreads the threads over different
+ * branches. The caller starts a search with a time budget and later stops it
+ * and reads the best move, so the game loop never waits for the search.
+*/
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "stdbool.h"
+#include "stdint.h"
+#include "stdatomic.h"
+#include "pthread.h"
+#include "sim.h"
+
+#define MCTS_VALUE_SCALE 1000000
+#define MCTS_MAX_DEPTH 64
+#define MCTS_ROLLOUT_DEPTH 48
+
+typedef struct MctsNode
+{
+    atomic_int children[4];   // Node index per SimDirection, 0 when not expanded
+    atomic_int visits;
+    atomic_llong value;       // Sum of rewards times MCTS_VALUE_SCALE
+} MctsNode;
+
+typedef struct Mcts
+{
+    pthread_t *threads;
+    int threadCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t idle;
+    int searchId;
+    int activeWorkers;
+    bool quit;
+
+    atomic_bool running;
+    double deadline;
+    bool isSearching;         // Only touched by the thread calling MctsStart/MctsStop
+
+    SimState root;
+    MctsNode *nodes;
+    int nodeCapacity;
+    atomic_int nodeCount;
+    atomic_llong iterations;
+} Mcts;
+
+void MctsInit(Mcts *mcts, int threadCount, int nodeCapacity);
+void MctsFree(Mcts *mcts);
+void MctsStart(Mcts *mcts, const SimState *root, double budget);
+void MctsStop(Mcts *mcts);
+int MctsGetMove(Mcts *mcts);
+
+#endif
@@ -0,0 +1,262 @@
+#include "neural.h"
+#include "observe.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "float.h"
+#include "limits.h"
+
+#if defined(__AVX2__)
+#include "immintrin.h"
+#elif defined(__SSE2__)
+#include "emmintrin.h"
+#endif
+
+#if defined(_WIN32)
+#include "malloc.h"
+#define NeuralAlignedAlloc(size) _aligned_malloc(size, 32)
+#define NeuralAlignedFree(pointer) _aligned_free(pointer)
+#else
+#define NeuralAlignedAlloc(size) aligned_alloc(32, size)
+#define NeuralAlignedFree(pointer) free(pointer)
+#endif
+
+static int NeuralPad(int count) {
+    return (count + 7) / 8 * 8;
+}
+
+static float* NeuralAllocate(int count) {
+    float *data = (float*) NeuralAlignedAlloc(sizeof(float) * NeuralPad(count));
+    memset(data, 0, sizeof(float) * NeuralPad(count));
+    return data;
+}
+
+size_t NeuralCountParameters(int inputCount, int hiddenCount) {
+    if (inputCount <= 0 || hiddenCount <= 0 || inputCount > NEURAL_MAX_PARAMETERS || hiddenCount > NEURAL_MAX_PARAMETERS) {
+        return 0;
+    }
+
+    // Padded rows are larger than the parameters they hold
+    uint64_t hiddenWeightCount = (uint64_t) hiddenCount * NeuralPad(inputCount);
+    uint64_t outputWeightCount = (uint64_t) NEURAL_OUTPUT_COUNT * NeuralPad(hiddenCount);
+    uint64_t count = (uint64_t) hiddenCount * (inputCount + 1) + (uint64_t) NEURAL_OUTPUT_COUNT * (hiddenCount + 1);
+
+    if (hiddenWeightCount > NEURAL_MAX_PARAMETERS || outputWeightCount > NEURAL_MAX_PARAMETERS || count > NEURAL_MAX_PARAMETERS) {
+        return 0;
+    }
+
+    return (size_t) count;
+}
+
+bool NeuralInit(NeuralNet *net, int inputCount, int hiddenCount) {
+    if (NeuralCountParameters(inputCount, hiddenCount) == 0) {
+        return false;
+    }
+
+    net->inputCount = inputCount;
+    net->hiddenCount = hiddenCount;
+    net->inputStride = NeuralPad(inputCount);
+    net->hiddenStride = NeuralPad(hiddenCount);
+    net->hiddenWeights = NeuralAllocate(hiddenCount * net->inputStride);
+    net->hiddenBias = NeuralAllocate(hiddenCount);
+    net->outputWeights = NeuralAllocate(NEURAL_OUTPUT_COUNT * net->hiddenStride);
+    net->outputBias = NeuralAllocate(NEURAL_OUTPUT_COUNT);
+    net->input = NeuralAllocate(inputCount);
+    net->hidden = NeuralAllocate(hiddenCount);
+
+    return true;
+}
+
+void NeuralFree(NeuralNet *net) {
+    NeuralAlignedFree(net->hiddenWeights);
+    NeuralAlignedFree(net->hiddenBias);
+    NeuralAlignedFree(net->outputWeights);
+    NeuralAlignedFree(net->outputBias);
+    NeuralAlignedFree(net->input);
+    NeuralAlignedFree(net->hidden);
+}
+
+size_t NeuralGetParameterCount(const NeuralNet *net) {
+    return NeuralCountParameters(net->inputCount, net->hiddenCount);
+}
+
+void NeuralGetParameters(const NeuralNet *net, float *parameters) {
+    for (int h = 0; h < net->hiddenCount; h++) {
+        memcpy(parameters, net->hiddenWeights + h * net->inputStride, sizeof(float) * net->inputCount);
+        parameters += net->inputCount;
+    }
+
+    memcpy(parameters, net->hiddenBias, sizeof(float) * net->hiddenCount);
+    parameters += net->hiddenCount;
+
+    for (int o = 0; o < NEURAL_OUTPUT_COUNT; o++) {
+        memcpy(parameters, net->outputWeights + o * net->hiddenStride, sizeof(float) * net->hiddenCount);
+        parameters += net->hiddenCount;
+    }
+
+    memcpy(parameters, net->outputBias, sizeof(float) * NEURAL_OUTPUT_COUNT);
+}
+
+void NeuralSetParameters(NeuralNet *net, const float *parameters) {
+    for (int h = 0; h < net->hiddenCount; h++) {
+        memcpy(net->hiddenWeights + h * net->inputStride, parameters, sizeof(float) * net->inputCount);
+        parameters += net->inputCount;
+    }
+
+    memcpy(net->hiddenBias, parameters, sizeof(float) * net->hiddenCount);
+    parameters += net->hiddenCount;
+
+    for (int o = 0; o < NEURAL_OUTPUT_COUNT; o++) {
+        memcpy(net->outputWeights + o * net->hiddenStride, parameters, sizeof(float) * net->hiddenCount);
+        parameters += net->hiddenCount;
+    }
+
+    memcpy(net->outputBias, parameters, sizeof(float) * NEURAL_OUTPUT_COUNT);
+}
+
+bool NeuralLoad(NeuralNet *net, const char *path) {
+    FILE *file = fopen(path, "rb");
+    NeuralHeader header;
+
+    if (file == NULL) {
+        return false;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != NEURAL_MAGIC ||
+        header.outputCount != NEURAL_OUTPUT_COUNT || header.inputCount > NEURAL_MAX_PARAMETERS || header.hiddenCount > NEURAL_MAX_PARAMETERS ||
+        !NeuralInit(net, header.inputCount, header.hiddenCount)) {
+        fclose(file);
+        return false;
+    }
+
+    size_t count = NeuralGetParameterCount(net);
+    float *parameters = (float*) malloc(sizeof(float) * count);
+    bool isRead = fread(parameters, sizeof(float), count, file) == count;
+
+    if (isRead) {
+        NeuralSetParameters(net, parameters);
+    } else {
+        NeuralFree(net);
+    }
+
+    free(parameters);
+    fclose(file);
+
+    return isRead;
+}
+
+bool NeuralSave(const NeuralNet *net, const char *path) {
+    FILE *file = fopen(path, "wb");
+    NeuralHeader header = {NEURAL_MAGIC, net->inputCount, net->hiddenCount, NEURAL_OUTPUT_COUNT};
+
+    if (file == NULL) {
+        return false;
+    }
+
+    size_t count = NeuralGetParameterCount(net);
+    float *parameters = (float*) malloc(sizeof(float) * count);
+
+    NeuralGetParameters(net, parameters);
+
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(parameters, sizeof(float), count, file) == count;
+
+    free(parameters);
+
+    return fclose(file) == 0 && isWritten;
+}
+
+// Both vectors are 32 byte aligned and padded to a multiple of 8
+static float NeuralDot(const float *a, const float *b, int count) {
+#if defined(__AVX2__)
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+
+    // Two accumulators hide the add latency
+    for (; i + 16 <= count; i += 16) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+        sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8)));
+    }
+
+    if (i < count) {
+        sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+    }
+
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+
+    return _mm_cvtss_f32(half);
+#elif defined(__SSE2__)
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+
+    for (int i = 0; i < count; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_load_ps(b + i + 4)));
+    }
+
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+    return _mm_cvtss_f32(sum);
+#else
+    float sum = 0;
+
+    for (int i = 0; i < count; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+#endif
+}
+
+// Input must be 32 byte aligned with inputStride floats, the padding set to zero
+void NeuralForward(NeuralNet *net, const float *input, float *output) {
+    for (int h = 0; h < net->hiddenCount; h++) {
+        float value = NeuralDot(net->hiddenWeights + h * net->inputStride, input, net->inputStride) + net->hiddenBias[h];
+        net->hidden[h] = value > 0 ? value : 0;
+    }
+
+    for (int o = 0; o < NEURAL_OUTPUT_COUNT; o++) {
+        output[o] = NeuralDot(net->outputWeights + o * net->hiddenStride, net->hidden, net->hiddenStride) + net->outputBias[o];
+    }
+}
+
+int NeuralChooseMove(NeuralNet *net, const SimState *state) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    float output[NEURAL_OUTPUT_COUNT];
+
+    if (net->inputCount != OBSERVE_PLANE_COUNT * tileMap->rows * tileMap->cols) {
+        return -1;
+    }
+
+    ObserveFloat(state, net->input);
+    NeuralForward(net, net->input, output);
+
+    int bestDirection = -1;
+    float bestValue = -FLT_MAX;
+
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        int next = SimNeighbor(tileMap, state->head, direction);
+
+        if (tileMap->tiles[next] == TILE_WALL || SimIsBodyAt(state, next)) {
+            continue;
+        }
+
+        if (output[direction] > bestValue) {
+            bestValue = output[direction];
+            bestDirection = direction;
+        }
+    }
+
+    // Every move dies, keep going straight
+    if (bestDirection < 0) {
+        bestDirection = state->direction >= 0 ? state->direction : SIM_RIGHT;
+    }
+
+    return bestDirection;
+}
@@ -0,0 +1,65 @@
+/**
+ * Small multilayer perceptron that picks moves from observation planes.
+ *
+ * One hidden ReLU layer and one output per direction, float32 weights
+ * evaluated with AVX2 or SSE2 dot products. Rows are padded to 8 floats so
+ * the kernels never need a scalar tail.
+ *
+ * Weight files are flat little endian binaries: a NeuralHeader followed by
+ * the hidden weights (hidden x inputs, row major), the hidden biases, the
+ * output weights (outputs x hidden) and the output biases, all float32.
+ * NeuralGetParameters uses the same order.
+*/
+#ifndef NEURAL_H
+#define NEURAL_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "sim.h"
+
+#define NEURAL_MAGIC 0x314E4E53 // "SNN1"
+#define NEURAL_OUTPUT_COUNT 4
+#define NEURAL_MAX_PARAMETERS (INT32_MAX / 4) // Weight buffers of any size still index and allocate in int
+
+typedef struct NeuralHeader
+{
+    uint32_t magic;
+    uint32_t inputCount;
+    uint32_t hiddenCount;
+    uint32_t outputCount;
+} NeuralHeader;
+
+typedef struct NeuralNet
+{
+    int inputCount;
+    int hiddenCount;
+    int inputStride;      // inputCount rounded up to 8
+    int hiddenStride;     // hiddenCount rounded up to 8
+
+    float *hiddenWeights; // hiddenCount rows of inputStride
+    float *hiddenBias;
+    float *outputWeights; // NEURAL_OUTPUT_COUNT rows of hiddenStride
+    float *outputBias;
+
+    float *input;         // Observation scratch, the padding stays zero
+    float *hidden;
+} NeuralNet;
+
+bool NeuralInit(NeuralNet *net, int inputCount, int hiddenCount);
+void NeuralFree(NeuralNet *net);
+bool NeuralLoad(NeuralNet *net, const char *path);
+bool NeuralSave(const NeuralNet *net, const char *path);
+
+// Parameters of a net with this shape, 0 when it is empty or too large
+size_t NeuralCountParameters(int inputCount, int hiddenCount);
+size_t NeuralGetParameterCount(const NeuralNet *net);
+void NeuralGetParameters(const NeuralNet *net, float *parameters);
+void NeuralSetParameters(NeuralNet *net, const float *parameters);
+
+void NeuralForward(NeuralNet *net, const float *input, float *output);
+
+// Best move that does not die right away, -1 when the net does not fit the board
+int NeuralChooseMove(NeuralNet *net, const SimState *state);
+
+#endif
@@ -0,0 +1,128 @@
+#include "observe.h"
+#include "string.h"
+
+#if defined(__AVX2__)
+#include "immintrin.h"
+#elif defined(__SSE2__)
+#include "emmintrin.h"
+#endif
+
+// 1.0f where the tile is a wall, 0.0f elsewhere
+static void ObserveWallsFloat(const TileValue *tiles, float *plane, int count) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i wall = _mm256_set1_epi32(TILE_WALL);
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i mask = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (tiles + i)), wall);
+        _mm256_storeu_ps(plane + i, _mm256_and_ps(_mm256_castsi256_ps(mask), one));
+    }
+#elif defined(__SSE2__)
+    __m128i wall = _mm_set1_epi32(TILE_WALL);
+    __m128 one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128i mask = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (tiles + i)), wall);
+        _mm_storeu_ps(plane + i, _mm_and_ps(_mm_castsi128_ps(mask), one));
+    }
+#endif
+
+    for (; i < count; i++) {
+        plane[i] = tiles[i] == TILE_WALL ? 1.0f : 0.0f;
+    }
+}
+
+// 1 where the tile is a wall, 0 elsewhere
+static void ObserveWallsUint8(const TileValue *tiles, uint8_t *plane, int count) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i wall = _mm256_set1_epi32(TILE_WALL);
+    __m256i one = _mm256_set1_epi8(1);
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (tiles + i)), wall);
+        __m256i b = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (tiles + i + 8)), wall);
+        __m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (tiles + i + 16)), wall);
+        __m256i d = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*) (tiles + i + 24)), wall);
+
+        // Packs work per 128 bit lane, the permute puts the 32 bytes back in order
+        __m256i bytes = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256((__m256i*) (plane + i), _mm256_and_si256(bytes, one));
+    }
+#elif defined(__SSE2__)
+    __m128i wall = _mm_set1_epi32(TILE_WALL);
+    __m128i one = _mm_set1_epi8(1);
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (tiles + i)), wall);
+        __m128i b = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (tiles + i + 4)), wall);
+        __m128i c = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (tiles + i + 8)), wall);
+        __m128i d = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*) (tiles + i + 12)), wall);
+        __m128i bytes = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+
+        _mm_storeu_si128((__m128i*) (plane + i), _mm_and_si128(bytes, one));
+    }
+#endif
+
+    for (; i < count; i++) {
+        plane[i] = tiles[i] == TILE_WALL;
+    }
+}
+
+void ObserveFloat(const SimState *state, float *planes) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int count = tileMap->rows * tileMap->cols;
+    int cells[SIM_MAX_LENGTH];
+    int length = SimGetBodyCells(state, cells);
+
+    memset(planes, 0, sizeof(float) * count * OBSERVE_PLANE_COUNT);
+
+    for (int i = 0; i < length; i++) {
+        planes[OBSERVE_BODY * count + cells[i]] = 1.0f;
+    }
+
+    planes[OBSERVE_HEAD * count + state->head] = 1.0f;
+
+    if (state->appleCell >= 0) {
+        planes[OBSERVE_APPLE * count + state->appleCell] = 1.0f;
+    }
+
+    ObserveWallsFloat(tileMap->tiles, planes + OBSERVE_WALL * count, count);
+
+    if (state->direction >= 0) {
+        float *plane = planes + (OBSERVE_DIRECTION + state->direction) * count;
+
+        for (int i = 0; i < count; i++) {
+            plane[i] = 1.0f;
+        }
+    }
+}
+
+void ObserveUint8(const SimState *state, uint8_t *planes) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int count = tileMap->rows * tileMap->cols;
+    int cells[SIM_MAX_LENGTH];
+    int length = SimGetBodyCells(state, cells);
+
+    memset(planes, 0, (size_t) count * OBSERVE_PLANE_COUNT);
+
+    for (int i = 0; i < length; i++) {
+        planes[OBSERVE_BODY * count + cells[i]] = 1;
+    }
+
+    planes[OBSERVE_HEAD * count + state->head] = 1;
+
+    if (state->appleCell >= 0) {
+        planes[OBSERVE_APPLE * count + state->appleCell] = 1;
+    }
+
+    ObserveWallsUint8(tileMap->tiles, planes + OBSERVE_WALL * count, count);
+
+    if (state->direction >= 0) {
+        memset(planes + (OBSERVE_DIRECTION + state->direction) * count, 1, count);
+    }
+}
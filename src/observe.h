@@ -0,0 +1,27 @@
+/**
+ * One-hot observation planes of a SimState for learning agents.
+ *
+ * Planes are written in NCHW order (plane, row, col) straight into a buffer
+ * owned by the caller, as float32 or uint8. Nothing is allocated, so the
+ * encoder can run every step of a training loop.
+*/
+#ifndef OBSERVE_H
+#define OBSERVE_H
+
+#include "stdint.h"
+#include "sim.h"
+
+typedef enum ObservePlane
+{
+    OBSERVE_BODY,
+    OBSERVE_HEAD,
+    OBSERVE_APPLE,
+    OBSERVE_WALL,
+    OBSERVE_DIRECTION, // One plane per SimDirection, all ones for the current direction
+    OBSERVE_PLANE_COUNT = OBSERVE_DIRECTION + 4,
+} ObservePlane;
+
+void ObserveFloat(const SimState *state, float *planes);
+void ObserveUint8(const SimState *state, uint8_t *planes);
+
+#endif
@@ -0,0 +1,344 @@
+/**
+ * Builds a level pack (see levelpack.h) from level sources.
+ *
+ * Sources:
+ * - .png images, one level per image, dark pixels are walls
+ * - text files, '#' is a wall and anything else is empty, levels are
+ *   separated by blank lines
+ * Every level must keep its open tiles connected to the start tile (1:1)
+ * like generated levels, levels that fail the check are skipped.
+ *
+ * Usage: ./build/pack [options] [sources...]
+ *   --generate N      also add N generated levels, styles in turn (default 0)
+ *   --size N          board size of generated levels (default 20)
+ *   --seed N          seed of generated levels (default 1)
+ *   --output PATH     (default assets/levels.pack)
+*/
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "raylib.h"
+#include "levelpack.h"
+#include "level.h"
+#include "clock.h"
+
+#define PACK_MAX_LINE 4096
+
+typedef struct Packer
+{
+    LevelPackEntry *entries;
+    int count;
+    int capacity;
+    uint8_t *data;
+    size_t dataSize;
+    size_t dataCapacity;
+    int skipped;
+} Packer;
+
+static void PackAdd(Packer *packer, TileMap *tileMap, const char *source) {
+    TilePosition start = {.row = 1, .col = 1};
+    LevelGenerator generator;
+
+    if (tileMap->rows < 4 || tileMap->cols < 4 || tileMap->rows > UINT16_MAX || tileMap->cols > UINT16_MAX) {
+        fprintf(stderr, "Skipping %s: %dx%d is not a valid board size\n", source, tileMap->rows, tileMap->cols);
+        packer->skipped++;
+        return;
+    }
+
+    LevelGeneratorInit(&generator, tileMap->rows, tileMap->cols);
+    bool isValid = LevelValidate(&generator, tileMap, GameGetTileIndex(tileMap, start));
+    LevelGeneratorFree(&generator);
+
+    if (!isValid) {
+        fprintf(stderr, "Skipping %s: open tiles are not connected to 1:1 or fill less than %.0f%% of the board\n",
+            source, LEVEL_MIN_FREE_RATIO * 100);
+        packer->skipped++;
+        return;
+    }
+
+    size_t maxSize = LevelPackGetMaxEncodedSize(tileMap->rows, tileMap->cols);
+
+    if (packer->count == packer->capacity) {
+        packer->capacity = packer->capacity > 0 ? packer->capacity * 2 : 64;
+        packer->entries = (LevelPackEntry*) realloc(packer->entries, sizeof(LevelPackEntry) * packer->capacity);
+    }
+
+    while (packer->dataSize + maxSize > packer->dataCapacity) {
+        packer->dataCapacity = packer->dataCapacity > 0 ? packer->dataCapacity * 2 : 1 << 16;
+        packer->data = (uint8_t*) realloc(packer->data, packer->dataCapacity);
+    }
+
+    LevelPackEncoding encoding;
+    size_t size = LevelPackEncode(tileMap, packer->data + packer->dataSize, &encoding);
+    LevelPackEntry *entry = &packer->entries[packer->count++];
+
+    memset(entry, 0, sizeof(LevelPackEntry));
+    entry->offset = packer->dataSize; // Made relative to the file start when written
+    entry->size = (uint32_t) size;
+    entry->rows = (uint16_t) tileMap->rows;
+    entry->cols = (uint16_t) tileMap->cols;
+    entry->encoding = encoding;
+    packer->dataSize += size;
+}
+
+static bool PackAddImage(Packer *packer, const char *path) {
+    Image image = LoadImage(path);
+
+    if (image.data == NULL) {
+        return false;
+    }
+
+    TileMap tileMap = {.rows = image.height, .cols = image.width, .tileWidth = 1, .tileHeight = 1};
+    Color *colors = LoadImageColors(image);
+
+    tileMap.tiles = (TileValue*) malloc(sizeof(TileValue) * tileMap.rows * tileMap.cols);
+
+    for (int i = 0; i < tileMap.rows * tileMap.cols; i++) {
+        int luminance = (colors[i].r * 299 + colors[i].g * 587 + colors[i].b * 114) / 1000;
+        tileMap.tiles[i] = colors[i].a >= 128 && luminance < 128 ? TILE_WALL : TILE_EMPTY;
+    }
+
+    PackAdd(packer, &tileMap, path);
+
+    free(tileMap.tiles);
+    UnloadImageColors(colors);
+    UnloadImage(image);
+
+    return true;
+}
+
+static void PackAddTextLevel(Packer *packer, char **lines, int rows, const char *path, int number) {
+    char source[PACK_MAX_LINE];
+    int cols = 0;
+
+    for (int row = 0; row < rows; row++) {
+        int length = (int) strlen(lines[row]);
+        cols = length > cols ? length : cols;
+    }
+
+    TileMap tileMap = {.rows = rows, .cols = cols, .tileWidth = 1, .tileHeight = 1};
+    tileMap.tiles = (TileValue*) calloc(rows * cols, sizeof(TileValue));
+
+    // Short lines are padded with empty tiles
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; lines[row][col] != '\0'; col++) {
+            tileMap.tiles[row * cols + col] = lines[row][col] == '#' ? TILE_WALL : TILE_EMPTY;
+        }
+    }
+
+    snprintf(source, sizeof(source), "%s level %d", path, number);
+    PackAdd(packer, &tileMap, source);
+    free(tileMap.tiles);
+}
+
+static bool PackAddText(Packer *packer, const char *path) {
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    char **lines = NULL;
+    int lineCount = 0;
+    int lineCapacity = 0;
+    int number = 1;
+    char buffer[PACK_MAX_LINE];
+
+    while (true) {
+        bool isEnd = fgets(buffer, sizeof(buffer), file) == NULL;
+
+        if (!isEnd) {
+            buffer[strcspn(buffer, "\r\n")] = '\0';
+        }
+
+        if (isEnd || buffer[0] == '\0') {
+            if (lineCount > 0) {
+                PackAddTextLevel(packer, lines, lineCount, path, number++);
+
+                for (int i = 0; i < lineCount; i++) {
+                    free(lines[i]);
+                }
+
+                lineCount = 0;
+            }
+
+            if (isEnd) {
+                break;
+            }
+
+            continue;
+        }
+
+        if (lineCount == lineCapacity) {
+            lineCapacity = lineCapacity > 0 ? lineCapacity * 2 : 64;
+            lines = (char**) realloc(lines, sizeof(char*) * lineCapacity);
+        }
+
+        lines[lineCount++] = strdup(buffer);
+    }
+
+    free(lines);
+    fclose(file);
+
+    return true;
+}
+
+static void PackAddGenerated(Packer *packer, int count, int size, uint64_t seed) {
+    TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+    TilePosition start = {.row = 1, .col = 1};
+    LevelGenerator generator;
+    char source[64];
+
+    tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+    LevelGeneratorInit(&generator, size, size);
+
+    for (int i = 0; i < count; i++) {
+        int number = i + 1;
+
+        LevelGenerate(&generator, &tileMap, number % LEVEL_STYLE_COUNT, seed + number, GameGetTileIndex(&tileMap, start));
+        snprintf(source, sizeof(source), "generated level %d", number);
+        PackAdd(packer, &tileMap, source);
+    }
+
+    LevelGeneratorFree(&generator);
+    free(tileMap.tiles);
+}
+
+static bool PackWrite(Packer *packer, const char *path) {
+    char temporaryPath[1024];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+
+    FILE *file = fopen(temporaryPath, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    LevelPackHeader header = {LEVEL_PACK_MAGIC, (uint32_t) packer->count};
+    uint64_t dataOffset = sizeof(LevelPackHeader) + sizeof(LevelPackEntry) * (uint64_t) packer->count;
+
+    for (int i = 0; i < packer->count; i++) {
+        packer->entries[i].offset += dataOffset;
+    }
+
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(packer->entries, sizeof(LevelPackEntry), packer->count, file) == (size_t) packer->count &&
+        fwrite(packer->data, 1, packer->dataSize, file) == packer->dataSize;
+
+    if (fclose(file) != 0 || !isWritten) {
+        remove(temporaryPath);
+        return false;
+    }
+
+    // Renamed so a game running from the same directory never maps half a pack
+    return rename(temporaryPath, path) == 0;
+}
+
+int main(int argc, char **argv) {
+    Packer packer = {0};
+    const char *outputPath = "assets/levels.pack";
+    const char **sources = (const char**) malloc(sizeof(char*) * argc);
+    int sourceCount = 0;
+    int generateCount = 0;
+    int size = 20;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            sources[sourceCount++] = argv[i];
+            continue;
+        }
+
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--generate") == 0) {
+            generateCount = atoi(value);
+        } else if (strcmp(argv[i], "--size") == 0) {
+            size = atoi(value);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--output") == 0) {
+            outputPath = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+
+        i++;
+    }
+
+    if (size < 4 || size > UINT16_MAX || generateCount < 0 || sourceCount + generateCount == 0) {
+        fprintf(stderr, "Invalid options\n");
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    for (int i = 0; i < sourceCount; i++) {
+        const char *extension = strrchr(sources[i], '.');
+        bool isImage = extension != NULL && (strcmp(extension, ".png") == 0 || strcmp(extension, ".PNG") == 0);
+        bool isRead = isImage ? PackAddImage(&packer, sources[i]) : PackAddText(&packer, sources[i]);
+
+        if (!isRead) {
+            fprintf(stderr, "Cannot read %s\n", sources[i]);
+            return 1;
+        }
+    }
+
+    PackAddGenerated(&packer, generateCount, size, seed);
+
+    if (packer.count == 0) {
+        fprintf(stderr, "No valid level to pack\n");
+        return 1;
+    }
+
+    if (!PackWrite(&packer, outputPath)) {
+        fprintf(stderr, "Cannot write %s\n", outputPath);
+        return 1;
+    }
+
+    // Read back like the game does
+    LevelPack pack;
+    double start = ClockNow();
+    bool isOpen = LevelPackOpen(&pack, outputPath);
+    double openTime = ClockNow() - start;
+
+    if (!isOpen) {
+        fprintf(stderr, "Cannot map %s\n", outputPath);
+        return 1;
+    }
+
+    int rleCount = 0;
+    int corrupt = 0;
+    start = ClockNow();
+
+    for (int i = 0; i < LevelPackGetCount(&pack); i++) {
+        TileMap tileMap = {.rows = pack.entries[i].rows, .cols = pack.entries[i].cols};
+        tileMap.tiles = (TileValue*) malloc(sizeof(TileValue) * tileMap.rows * tileMap.cols);
+
+        rleCount += pack.entries[i].encoding == LEVEL_PACK_RLE;
+        corrupt += !LevelPackDecode(&pack, i, &tileMap);
+        free(tileMap.tiles);
+    }
+
+    double decodeTime = ClockNow() - start;
+
+    printf("%s: %d levels (%d rle, %d bits), %d skipped, %zu bytes of grids, open %.3fms, decode %.2fus per level\n",
+        outputPath, packer.count, rleCount, packer.count - rleCount, packer.skipped, packer.dataSize,
+        openTime * 1e3, decodeTime / packer.count * 1e6);
+
+    LevelPackClose(&pack);
+    free(packer.entries);
+    free(packer.data);
+    free(sources);
+
+    if (corrupt > 0) {
+        fprintf(stderr, "%d levels do not decode\n", corrupt);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "path.h"
+#include "sim.h"
+#include "stdlib.h"
+#include "string.h"
+
+void PathFinderInit(PathFinder *pathFinder, int rows, int cols) {
+    int cellCount = rows * cols;
+
+    pathFinder->rows = rows;
+    pathFinder->cols = cols;
+    pathFinder->neighbors = (int*) malloc(sizeof(int) * cellCount * 4);
+    pathFinder->freeAt = (int*) calloc(cellCount, sizeof(int));
+    pathFinder->parent = (int*) malloc(sizeof(int) * cellCount);
+    pathFinder->queue = (int*) malloc(sizeof(int) * cellCount);
+    pathFinder->visited = (uint32_t*) calloc(cellCount, sizeof(uint32_t));
+    pathFinder->goals = (uint32_t*) calloc(cellCount, sizeof(uint32_t));
+    pathFinder->generation = 0;
+    pathFinder->path = (int*) malloc(sizeof(int) * cellCount);
+    pathFinder->pathLength = 0;
+
+    TileMap tileMap = {.rows = rows, .cols = cols};
+
+    for (int cell = 0; cell < cellCount; cell++) {
+        for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+            pathFinder->neighbors[cell * 4 + direction] = SimNeighbor(&tileMap, cell, direction);
+        }
+    }
+}
+
+void PathFinderFree(PathFinder *pathFinder) {
+    free(pathFinder->neighbors);
+    free(pathFinder->freeAt);
+    free(pathFinder->parent);
+    free(pathFinder->queue);
+    free(pathFinder->visited);
+    free(pathFinder->goals);
+    free(pathFinder->path);
+}
+
+void PathFinderClearObstacles(PathFinder *pathFinder, TileMap *tileMap) {
+    int cellCount = pathFinder->rows * pathFinder->cols;
+
+    for (int cell = 0; cell < cellCount; cell++) {
+        pathFinder->freeAt[cell] = tileMap->tiles[cell] == TILE_WALL ? PATH_BLOCKED_FOREVER : 0;
+    }
+}
+
+void PathFinderBlockCell(PathFinder *pathFinder, int cell, int freeAt) {
+    if (pathFinder->freeAt[cell] < freeAt) {
+        pathFinder->freeAt[cell] = freeAt;
+    }
+}
+
+// Segment i leaves its cell after length - i moves, later if the snake is still growing
+void PathFinderBlockSnake(PathFinder *pathFinder, int head, const int *bodyCells, int length, int pendingGrowth) {
+    PathFinderBlockCell(pathFinder, head, length + pendingGrowth + 1);
+
+    for (int i = 0; i < length; i++) {
+        PathFinderBlockCell(pathFinder, bodyCells[i], length - i + pendingGrowth);
+    }
+}
+
+static void PathFinderNextGeneration(PathFinder *pathFinder) {
+    pathFinder->generation++;
+
+    if (pathFinder->generation == 0) {
+        int cellCount = pathFinder->rows * pathFinder->cols;
+
+        memset(pathFinder->visited, 0, sizeof(uint32_t) * cellCount);
+        memset(pathFinder->goals, 0, sizeof(uint32_t) * cellCount);
+        pathFinder->generation = 1;
+    }
+}
+
+static int PathFinderGetDirection(PathFinder *pathFinder, int from, int to) {
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        if (pathFinder->neighbors[from * 4 + direction] == to) {
+            return direction;
+        }
+    }
+
+    return -1;
+}
+
+// Breadth first search to the nearest goal, returns the direction of the first step or -1
+int PathFinderSearch(PathFinder *pathFinder, int start, const int *goals, int goalCount) {
+    PathFinderNextGeneration(pathFinder);
+
+    uint32_t generation = pathFinder->generation;
+    int *queue = pathFinder->queue;
+    int head = 0;
+    int tail = 0;
+
+    pathFinder->pathLength = 0;
+
+    for (int i = 0; i < goalCount; i++) {
+        pathFinder->goals[goals[i]] = generation;
+    }
+
+    queue[tail++] = start;
+    pathFinder->visited[start] = generation;
+    pathFinder->parent[start] = -1;
+
+    // The queue holds a whole depth level between level markers
+    int depth = 0;
+    int levelEnd = tail;
+
+    while (head < tail) {
+        if (head == levelEnd) {
+            depth++;
+            levelEnd = tail;
+        }
+
+        int cell = queue[head++];
+        const int *neighbors = &pathFinder->neighbors[cell * 4];
+
+        for (int direction = 0; direction < 4; direction++) {
+            int next = neighbors[direction];
+
+            if (pathFinder->visited[next] == generation || pathFinder->freeAt[next] > depth + 1) {
+                continue;
+            }
+
+            pathFinder->visited[next] = generation;
+            pathFinder->parent[next] = cell;
+
+            if (pathFinder->goals[next] == generation) {
+                int length = 0;
+
+                for (int step = next; step != start; step = pathFinder->parent[step]) {
+                    length++;
+                }
+
+                pathFinder->pathLength = length;
+
+                for (int step = next; step != start; step = pathFinder->parent[step]) {
+                    pathFinder->path[--length] = step;
+                }
+
+                return PathFinderGetDirection(pathFinder, start, pathFinder->path[0]);
+            }
+
+            queue[tail++] = next;
+        }
+    }
+
+    return -1;
+}
+
+// Used when no goal is reachable, keeps going straight if the next cell is free
+int PathFinderGetSafeDirection(PathFinder *pathFinder, int start, int preferredDirection) {
+    const int *neighbors = &pathFinder->neighbors[start * 4];
+
+    if (preferredDirection >= 0 && pathFinder->freeAt[neighbors[preferredDirection]] <= 1) {
+        return preferredDirection;
+    }
+
+    for (int direction = 0; direction < 4; direction++) {
+        if (pathFinder->freeAt[neighbors[direction]] <= 1) {
+            return direction;
+        }
+    }
+
+    return preferredDirection;
+}
@@ -0,0 +1,43 @@
+/**
+ * Shortest path search over the wraparound tile grid.
+ *
+ * Every buffer is allocated once in PathFinderInit so planning a move never
+ * allocates. Obstacles store the tick at which a cell becomes free, so body
+ * segments that will have moved away by the time the head gets there are not
+ * treated as walls.
+*/
+#ifndef PATH_H
+#define PATH_H
+
+#include "stdint.h"
+#include "tilemap.h"
+
+#define PATH_BLOCKED_FOREVER 0x7fffffff
+
+typedef struct PathFinder
+{
+    int rows;
+    int cols;
+    int *neighbors;       // 4 per cell, indexed with SimDirection
+    int *freeAt;          // Tick at which the cell can be entered, 0 when empty
+    int *parent;
+    int *queue;
+    uint32_t *visited;    // Generation stamps so nothing is cleared between searches
+    uint32_t *goals;
+    uint32_t generation;
+
+    int *path;            // Cells from the first step to the goal
+    int pathLength;
+} PathFinder;
+
+void PathFinderInit(PathFinder *pathFinder, int rows, int cols);
+void PathFinderFree(PathFinder *pathFinder);
+
+void PathFinderClearObstacles(PathFinder *pathFinder, TileMap *tileMap);
+void PathFinderBlockCell(PathFinder *pathFinder, int cell, int freeAt);
+void PathFinderBlockSnake(PathFinder *pathFinder, int head, const int *bodyCells, int length, int pendingGrowth);
+
+int PathFinderSearch(PathFinder *pathFinder, int start, const int *goals, int goalCount);
+int PathFinderGetSafeDirection(PathFinder *pathFinder, int start, int preferredDirection);
+
+#endif
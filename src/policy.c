@@ -0,0 +1,204 @@
+#include "policy.h"
+#include "path.h"
+#include "hamilton.h"
+#include "neural.h"
+#include "stdlib.h"
+#include "string.h"
+
+typedef struct PolicyContext
+{
+    TileMap tileMap;
+    int *bodyCells;
+    PathFinder pathFinder;
+    HamiltonCycle hamilton;
+    NeuralNet neuralNet;
+} PolicyContext;
+
+int PolicyWrappedDistance(const TileMap *tileMap, int a, int b) {
+    int rows = abs(a / tileMap->cols - b / tileMap->cols);
+    int cols = abs(a % tileMap->cols - b % tileMap->cols);
+
+    rows = rows < tileMap->rows - rows ? rows : tileMap->rows - rows;
+    cols = cols < tileMap->cols - cols ? cols : tileMap->cols - cols;
+
+    return rows + cols;
+}
+
+static bool PolicyIsDeadly(const SimState *state, int direction) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int next = SimNeighbor(tileMap, state->head, direction);
+
+    if (state->length > 0 && state->direction >= 0 && direction == ((state->direction + 2) & 3)) {
+        return true;
+    }
+
+    return tileMap->tiles[next] == TILE_WALL || SimIsBodyAt(state, next);
+}
+
+static void* PolicyCreateEmpty(TileMap *tileMap) {
+    PolicyContext *context = (PolicyContext*) calloc(1, sizeof(PolicyContext));
+    context->tileMap = *tileMap;
+    return context;
+}
+
+static void PolicyDestroyEmpty(void *context) {
+    free(context);
+}
+
+// Any move that does not die right away
+static int PolicyRandomMove(void *context, const SimState *state, uint64_t *rng) {
+    int moves[4];
+    int moveCount = 0;
+
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        if (!PolicyIsDeadly(state, direction)) {
+            moves[moveCount++] = direction;
+        }
+    }
+
+    if (moveCount == 0) {
+        return state->direction >= 0 ? state->direction : SIM_RIGHT;
+    }
+
+    return moves[SimRandom(rng) % moveCount];
+}
+
+// Closest safe step towards the apple, like the eyes following GetClosestItem
+static int PolicyGreedyMove(void *context, const SimState *state, uint64_t *rng) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int bestDirection = -1;
+    int bestDistance = 0;
+
+    if (state->appleCell < 0) {
+        return PolicyRandomMove(context, state, rng);
+    }
+
+    for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+        if (PolicyIsDeadly(state, direction)) {
+            continue;
+        }
+
+        int distance = PolicyWrappedDistance(tileMap, SimNeighbor(tileMap, state->head, direction), state->appleCell);
+
+        if (bestDirection < 0 || distance < bestDistance) {
+            bestDirection = direction;
+            bestDistance = distance;
+        }
+    }
+
+    return bestDirection >= 0 ? bestDirection : PolicyRandomMove(context, state, rng);
+}
+
+static void* PolicyCreateBfs(TileMap *tileMap) {
+    PolicyContext *context = (PolicyContext*) PolicyCreateEmpty(tileMap);
+
+    context->bodyCells = (int*) malloc(sizeof(int) * SIM_MAX_LENGTH);
+    PathFinderInit(&context->pathFinder, tileMap->rows, tileMap->cols);
+
+    return context;
+}
+
+static void PolicyDestroyBfs(void *data) {
+    PolicyContext *context = (PolicyContext*) data;
+
+    PathFinderFree(&context->pathFinder);
+    free(context->bodyCells);
+    free(context);
+}
+
+static int PolicyBfsMove(void *data, const SimState *state, uint64_t *rng) {
+    PolicyContext *context = (PolicyContext*) data;
+    PathFinder *pathFinder = &context->pathFinder;
+    int length = SimGetBodyCells(state, context->bodyCells);
+    int goalCount = state->appleCell >= 0 ? 1 : 0;
+
+    PathFinderClearObstacles(pathFinder, &state->tileMap->tileMap);
+    PathFinderBlockSnake(pathFinder, state->head, context->bodyCells, length, state->pendingGrowth);
+
+    int direction = PathFinderSearch(pathFinder, state->head, &state->appleCell, goalCount);
+
+    if (direction < 0) {
+        direction = PathFinderGetSafeDirection(pathFinder, state->head, state->direction);
+    }
+
+    return direction >= 0 ? direction : PolicyRandomMove(data, state, rng);
+}
+
+static void* PolicyCreateHamilton(TileMap *tileMap) {
+    PolicyContext *context = (PolicyContext*) PolicyCreateEmpty(tileMap);
+
+    context->bodyCells = (int*) malloc(sizeof(int) * SIM_MAX_LENGTH);
+    HamiltonInit(&context->hamilton, tileMap->rows, tileMap->cols);
+    context->hamilton.length = -1; // Built on the first move, from the start cell
+
+    return context;
+}
+
+static void PolicyDestroyHamilton(void *data) {
+    PolicyContext *context = (PolicyContext*) data;
+
+    HamiltonFree(&context->hamilton);
+    free(context->bodyCells);
+    free(context);
+}
+
+static int PolicyHamiltonMove(void *data, const SimState *state, uint64_t *rng) {
+    PolicyContext *context = (PolicyContext*) data;
+
+    if (context->hamilton.length < 0) {
+        HamiltonBuild(&context->hamilton, &state->tileMap->tileMap, state->head);
+    }
+
+    int length = SimGetBodyCells(state, context->bodyCells);
+    int tail = length > 0 ? context->bodyCells[length - 1] : state->head;
+    int direction = HamiltonGetDirection(&context->hamilton, state->head, tail, state->appleCell, length + 1);
+
+    return direction >= 0 ? direction : PolicyRandomMove(data, state, rng);
+}
+
+// Weights from $SNAKE_NEURAL_WEIGHTS or the game's default file, fails without them
+static void* PolicyCreateNeural(TileMap *tileMap) {
+    PolicyContext *context = (PolicyContext*) PolicyCreateEmpty(tileMap);
+    const char *path = getenv("SNAKE_NEURAL_WEIGHTS");
+
+    if (!NeuralLoad(&context->neuralNet, path != NULL ? path : "assets/policy.nn")) {
+        free(context);
+        return NULL;
+    }
+
+    return context;
+}
+
+static void PolicyDestroyNeural(void *data) {
+    PolicyContext *context = (PolicyContext*) data;
+
+    NeuralFree(&context->neuralNet);
+    free(context);
+}
+
+static int PolicyNeuralMove(void *data, const SimState *state, uint64_t *rng) {
+    PolicyContext *context = (PolicyContext*) data;
+    int direction = NeuralChooseMove(&context->neuralNet, state);
+
+    return direction >= 0 ? direction : PolicyGreedyMove(data, state, rng);
+}
+
+const Policy policies[] = {
+    {"random", PolicyCreateEmpty, PolicyRandomMove, PolicyDestroyEmpty},
+    {"greedy", PolicyCreateEmpty, PolicyGreedyMove, PolicyDestroyEmpty},
+    {"bfs", PolicyCreateBfs, PolicyBfsMove, PolicyDestroyBfs},
+    {"hamilton", PolicyCreateHamilton, PolicyHamiltonMove, PolicyDestroyHamilton},
+    {"neural", PolicyCreateNeural, PolicyNeuralMove, PolicyDestroyNeural},
+};
+
+const int policyCount = sizeof(policies) / sizeof(policies[0]);
+
+const Policy* PolicyFind(const char *name) {
+    for (int i = 0; i < policyCount; i++) {
+        if (strcmp(policies[i].name, name) == 0) {
+            return &policies[i];
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,26 @@
+/**
+ * Headless bots that pick the next move for a SimState.
+ *
+ * Every policy creates its own context, so one context per thread can run
+ * games in parallel without sharing anything.
+*/
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "sim.h"
+
+typedef struct Policy
+{
+    const char *name;
+    void* (*create)(TileMap *tileMap);    // NULL when the policy can't run, like a neural net without weights
+    int (*move)(void *context, const SimState *state, uint64_t *rng);
+    void (*destroy)(void *context);
+} Policy;
+
+extern const Policy policies[];
+extern const int policyCount;
+
+const Policy* PolicyFind(const char *name);
+int PolicyWrappedDistance(const TileMap *tileMap, int a, int b);
+
+#endif
@@ -0,0 +1,297 @@
+#include "sim.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stddef.h"
+
+static int SimBodyWords(int length) {
+    int words = (length + 31) / 32;
+    return words < SIM_BODY_WORDS ? words : SIM_BODY_WORDS;
+}
+
+uint64_t SimRandom(uint64_t *rng) {
+    uint64_t x = *rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+SimTileMap* SimTileMapCreate(TileMap *tileMap) {
+    SimTileMap *simTileMap = (SimTileMap*) malloc(sizeof(SimTileMap));
+    size_t size = sizeof(TileValue) * tileMap->rows * tileMap->cols;
+
+    simTileMap->tileMap = *tileMap;
+    simTileMap->tileMap.tiles = (TileValue*) malloc(size);
+    memcpy(simTileMap->tileMap.tiles, tileMap->tiles, size);
+    atomic_init(&simTileMap->refCount, 1);
+
+    return simTileMap;
+}
+
+SimTileMap* SimTileMapRetain(SimTileMap *tileMap) {
+    atomic_fetch_add_explicit(&tileMap->refCount, 1, memory_order_relaxed);
+    return tileMap;
+}
+
+void SimTileMapRelease(SimTileMap *tileMap) {
+    if (atomic_fetch_sub_explicit(&tileMap->refCount, 1, memory_order_acq_rel) == 1) {
+        free(tileMap->tileMap.tiles);
+        free(tileMap);
+    }
+}
+
+void SimInit(SimState *state, SimTileMap *tileMap, TilePosition head, uint64_t seed) {
+    state->tileMap = SimTileMapRetain(tileMap);
+    state->head = head.row * tileMap->tileMap.cols + head.col;
+    state->tail = state->head;
+    state->length = 0;
+    state->pendingGrowth = 1; // The game starts with one tail segment under the head
+    state->direction = -1;
+    state->appleCell = -1;
+    state->score = 0;
+    state->ticks = 0;
+    state->isOver = false;
+    state->rng = seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+    state->hash = SimComputeHash(state);
+
+    SimSpawnApple(state);
+}
+
+void SimFork(SimState *dst, const SimState *src) {
+    memcpy(dst, src, offsetof(SimState, body));
+    memcpy(dst->body, src->body, sizeof(uint64_t) * SimBodyWords(src->length));
+    SimTileMapRetain(dst->tileMap);
+}
+
+void SimRelease(SimState *state) {
+    if (state->tileMap != NULL) {
+        SimTileMapRelease(state->tileMap);
+        state->tileMap = NULL;
+    }
+}
+
+void SimSetTile(SimState *state, int cell, TileValue value) {
+    SimTileMap *tileMap = state->tileMap;
+
+    if (atomic_load_explicit(&tileMap->refCount, memory_order_acquire) > 1) {
+        state->tileMap = SimTileMapCreate(&tileMap->tileMap);
+        SimTileMapRelease(tileMap);
+    }
+
+    state->tileMap->tileMap.tiles[cell] = value;
+}
+
+int SimNeighbor(const TileMap *tileMap, int cell, int direction) {
+    int row = cell / tileMap->cols;
+    int col = cell % tileMap->cols;
+
+    switch (direction) {
+        case SIM_UP: row = row == 0 ? tileMap->rows - 1 : row - 1; break;
+        case SIM_DOWN: row = row == tileMap->rows - 1 ? 0 : row + 1; break;
+        case SIM_LEFT: col = col == 0 ? tileMap->cols - 1 : col - 1; break;
+        case SIM_RIGHT: col = col == tileMap->cols - 1 ? 0 : col + 1; break;
+    }
+
+    return row * tileMap->cols + col;
+}
+
+int SimGetSegmentDirection(const SimState *state, int index) {
+    return (state->body[index / 32] >> ((index % 32) * 2)) & 3;
+}
+
+void SimAppendSegment(SimState *state, int direction) {
+    if (state->length >= SIM_MAX_LENGTH) {
+        return;
+    }
+
+    int word = state->length / 32;
+    int shift = (state->length % 32) * 2;
+
+    if (shift == 0) {
+        state->body[word] = 0;
+    }
+
+    state->body[word] = (state->body[word] & ~(3ULL << shift)) | ((uint64_t) direction << shift);
+    state->length++;
+    state->tail = SimNeighbor(&state->tileMap->tileMap, state->tail, (direction + 2) & 3);
+    state->hash ^= ZobristKey(ZOBRIST_BODY, state->tail);
+}
+
+// Walks the body from the head calling visit for every segment cell, stops when visit returns true
+static bool SimWalkBody(const SimState *state, bool (*visit)(int cell, int index, void *data), void *data) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int row = state->head / tileMap->cols;
+    int col = state->head % tileMap->cols;
+
+    for (int i = 0; i < state->length; i++) {
+        switch (SimGetSegmentDirection(state, i)) {
+            case SIM_UP: row = row == tileMap->rows - 1 ? 0 : row + 1; break;
+            case SIM_DOWN: row = row == 0 ? tileMap->rows - 1 : row - 1; break;
+            case SIM_LEFT: col = col == tileMap->cols - 1 ? 0 : col + 1; break;
+            case SIM_RIGHT: col = col == 0 ? tileMap->cols - 1 : col - 1; break;
+        }
+
+        if (visit(row * tileMap->cols + col, i, data)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool SimVisitMatch(int cell, int index, void *data) {
+    return cell == *(int*) data;
+}
+
+static bool SimVisitStore(int cell, int index, void *data) {
+    ((int*) data)[index] = cell;
+    return false;
+}
+
+static bool SimVisitMark(int cell, int index, void *data) {
+    ((uint64_t*) data)[cell / 64] |= 1ULL << (cell % 64);
+    return false;
+}
+
+bool SimIsBodyAt(const SimState *state, int cell) {
+    return SimWalkBody(state, SimVisitMatch, &cell);
+}
+
+int SimGetBodyCells(const SimState *state, int *cells) {
+    SimWalkBody(state, SimVisitStore, cells);
+    return state->length;
+}
+
+static bool SimIsCellFree(const SimState *state, int cell) {
+    return state->tileMap->tileMap.tiles[cell] != TILE_WALL && cell != state->head && !SimIsBodyAt(state, cell);
+}
+
+void SimSpawnApple(SimState *state) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int cellCount = tileMap->rows * tileMap->cols;
+
+    if (state->appleCell >= 0) {
+        state->hash ^= ZobristKey(ZOBRIST_APPLE, state->appleCell);
+        state->appleCell = -1;
+    }
+
+    for (int attempt = 0; attempt < 64; attempt++) {
+        int cell = SimRandom(&state->rng) % cellCount;
+
+        if (SimIsCellFree(state, cell)) {
+            state->appleCell = cell;
+            state->hash ^= ZobristKey(ZOBRIST_APPLE, cell);
+            return;
+        }
+    }
+
+    // Crowded board, fall back to the first free cell after a random start.
+    // The body is walked once into a bitmap instead of once per cell.
+    uint64_t *occupied = (uint64_t*) calloc((cellCount + 63) / 64, sizeof(uint64_t));
+    int start = SimRandom(&state->rng) % cellCount;
+
+    SimWalkBody(state, SimVisitMark, occupied);
+    SimVisitMark(state->head, 0, occupied);
+
+    for (int i = 0; i < cellCount; i++) {
+        int cell = (start + i) % cellCount;
+
+        if (tileMap->tiles[cell] != TILE_WALL && !(occupied[cell / 64] & (1ULL << (cell % 64)))) {
+            state->appleCell = cell;
+            state->hash ^= ZobristKey(ZOBRIST_APPLE, cell);
+            break;
+        }
+    }
+
+    free(occupied);
+}
+
+void SimStep(SimState *state, int direction) {
+    if (state->isOver) {
+        return;
+    }
+
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    int oldHead = state->head;
+    int head = SimNeighbor(tileMap, oldHead, direction);
+    bool grows = state->pendingGrowth > 0 && state->length < SIM_MAX_LENGTH;
+    int droppedDirection = state->length > 0 ? SimGetSegmentDirection(state, state->length - 1) : -1;
+    int words = SimBodyWords(grows ? state->length + 1 : state->length);
+
+    if (state->length == 0 && !grows) {
+        // No body, only the head moves
+        state->tail = head;
+    } else {
+        // Push the old head cell at the front of the body
+        if (grows && state->length % 32 == 0) {
+            state->body[words - 1] = 0;
+        }
+
+        for (int w = words - 1; w > 0; w--) {
+            state->body[w] = (state->body[w] << 2) | (state->body[w - 1] >> 62);
+        }
+
+        state->body[0] = (state->body[0] << 2) | (uint64_t) direction;
+        state->hash ^= ZobristKey(ZOBRIST_BODY, oldHead);
+
+        if (grows) {
+            state->hash ^= ZobristGrowthKey(state->pendingGrowth) ^ ZobristGrowthKey(state->pendingGrowth - 1);
+            state->pendingGrowth--;
+            state->length++;
+
+            if (state->length == 1) {
+                state->tail = oldHead;
+            }
+        } else {
+            // Drop the segment that fell off the end, at the max length it was shifted out of the last word
+            if (state->length < SIM_MAX_LENGTH) {
+                state->body[state->length / 32] &= ~(3ULL << ((state->length % 32) * 2));
+            } else {
+                state->hash ^= ZobristGrowthKey(state->pendingGrowth);
+                state->pendingGrowth = 0;
+            }
+
+            state->hash ^= ZobristKey(ZOBRIST_BODY, state->tail);
+            state->tail = SimNeighbor(tileMap, state->tail, droppedDirection);
+        }
+    }
+
+    state->hash ^= ZobristKey(ZOBRIST_HEAD, oldHead) ^ ZobristKey(ZOBRIST_HEAD, head);
+    state->head = head;
+    state->direction = direction;
+    state->ticks++;
+
+    if (head == state->appleCell) {
+        state->score += SIM_APPLE_SCORE;
+        state->hash ^= ZobristGrowthKey(state->pendingGrowth) ^ ZobristGrowthKey(state->pendingGrowth + 1);
+        state->pendingGrowth++;
+        SimSpawnApple(state);
+    }
+
+    if (tileMap->tiles[head] == TILE_WALL || SimIsBodyAt(state, head)) {
+        state->isOver = true;
+    }
+}
+
+// Full hash from scratch, SimStep and SimSpawnApple keep state->hash up to date incrementally
+uint64_t SimComputeHash(const SimState *state) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+    uint64_t hash = ZobristKey(ZOBRIST_HEAD, state->head) ^ ZobristGrowthKey(state->pendingGrowth);
+    int cell = state->head;
+
+    for (int i = 0; i < state->length; i++) {
+        cell = SimNeighbor(tileMap, cell, (SimGetSegmentDirection(state, i) + 2) & 3);
+        hash ^= ZobristKey(ZOBRIST_BODY, cell);
+    }
+
+    if (state->appleCell >= 0) {
+        hash ^= ZobristKey(ZOBRIST_APPLE, state->appleCell);
+    }
+
+    return hash;
+}
+
+uint64_t SimGetHash(const SimState *state) {
+    return state->hash ^ ZobristDirectionKey(state->direction);
+}
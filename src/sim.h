@@ -0,0 +1,83 @@
+/**
+ * Headless, tick based copy of the game rules for AI search and tools.
+ *
+ * A SimState is small on purpose so it can be forked thousands of times per
+ * decision:
+ * - the tile map is shared between forks and only copied when written to
+ * - the snake body is stored as 2 bit directions, one per segment
+ * - only the apple cell is kept instead of the full item array
+ *
+ * Differences with the windowed game: time is counted in ticks, apples do not
+ * expire and a new apple spawns right after one is eaten. Like in the game,
+ * moving into a wall or into the body ends it.
+*/
+#ifndef SIM_H
+#define SIM_H
+
+#include "stdint.h"
+#include "stdatomic.h"
+#include "tilemap.h"
+#include "zobrist.h"
+
+#define SIM_MAX_LENGTH 4096
+#define SIM_BODY_WORDS (SIM_MAX_LENGTH / 32)
+#define SIM_APPLE_SCORE 5
+
+typedef enum SimDirection
+{
+    SIM_UP,
+    SIM_RIGHT,
+    SIM_DOWN,
+    SIM_LEFT,
+} SimDirection;
+
+typedef struct SimTileMap
+{
+    atomic_int refCount;
+    TileMap tileMap;
+} SimTileMap;
+
+typedef struct SimState
+{
+    SimTileMap *tileMap;
+
+    int head;          // Cell index (row * cols + col)
+    int tail;          // Last body cell, the head when there is no body
+    int length;        // Body segments behind the head
+    int pendingGrowth; // Segments added on the next moves
+    int direction;     // SimDirection or -1 before the first move
+    int appleCell;     // -1 when there is no apple
+    int score;
+    int ticks;
+    bool isOver;
+    uint64_t rng;
+    uint64_t hash;     // Zobrist hash without the direction, see SimGetHash
+
+    // Segment i stores the direction from segment i to segment i - 1 (the head for i = 0)
+    uint64_t body[SIM_BODY_WORDS];
+} SimState;
+
+SimTileMap* SimTileMapCreate(TileMap *tileMap);
+SimTileMap* SimTileMapRetain(SimTileMap *tileMap);
+void SimTileMapRelease(SimTileMap *tileMap);
+
+void SimInit(SimState *state, SimTileMap *tileMap, TilePosition head, uint64_t seed);
+void SimFork(SimState *dst, const SimState *src);
+void SimRelease(SimState *state);
+void SimSetTile(SimState *state, int cell, TileValue value);
+
+void SimStep(SimState *state, int direction);
+void SimSpawnApple(SimState *state);
+
+int SimNeighbor(const TileMap *tileMap, int cell, int direction);
+int SimGetSegmentDirection(const SimState *state, int index);
+void SimAppendSegment(SimState *state, int direction);
+bool SimIsBodyAt(const SimState *state, int cell);
+int SimGetBodyCells(const SimState *state, int *cells);
+
+uint64_t SimComputeHash(const SimState *state);
+uint64_t SimGetHash(const SimState *state);
+
+uint64_t SimRandom(uint64_t *rng);
+
+#endif
@@ -0,0 +1,280 @@
+#include "snakebody.h"
+#include "sim.h"
+#include "stdlib.h"
+#include "string.h"
+
+#define SNAKE_BODY_MIN_CAPACITY 16
+
+// Cell steps away from cell in direction, wrapping around the board edges
+static int SnakeBodyStep(const SnakeBody *body, int cell, int direction, int steps) {
+    int row = cell / body->cols;
+    int col = cell % body->cols;
+
+    switch (direction) {
+        case SIM_UP: row = (row - steps % body->rows + body->rows) % body->rows; break;
+        case SIM_RIGHT: col = (col + steps) % body->cols; break;
+        case SIM_DOWN: row = (row + steps) % body->rows; break;
+        case SIM_LEFT: col = (col - steps % body->cols + body->cols) % body->cols; break;
+    }
+
+    return row * body->cols + col;
+}
+
+// Steps from cell in direction before the board edge
+static int SnakeBodyGetEdgeDistance(const SnakeBody *body, int cell, int direction) {
+    int row = cell / body->cols;
+    int col = cell % body->cols;
+
+    switch (direction) {
+        case SIM_UP: return row;
+        case SIM_RIGHT: return body->cols - 1 - col;
+        case SIM_DOWN: return body->rows - 1 - row;
+        default: return col;
+    }
+}
+
+static SnakeRun* SnakeBodyGetRun(const SnakeBody *body, int run) {
+    return &body->runs[(body->first + run) & (body->capacity - 1)];
+}
+
+// Makes room for count runs, the ring is laid out from index 0 again
+static void SnakeBodyReserve(SnakeBody *body, int count) {
+    if (count <= body->capacity) {
+        return;
+    }
+
+    int capacity = body->capacity > 0 ? body->capacity : SNAKE_BODY_MIN_CAPACITY;
+
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    SnakeRun *runs = (SnakeRun*) malloc(sizeof(SnakeRun) * capacity);
+
+    for (int i = 0; i < body->runCount; i++) {
+        runs[i] = *SnakeBodyGetRun(body, i);
+    }
+
+    free(body->runs);
+    body->runs = runs;
+    body->first = 0;
+    body->capacity = capacity;
+}
+
+void SnakeBodyInit(SnakeBody *body, int rows, int cols, int head) {
+    memset(body, 0, sizeof(SnakeBody));
+    body->rows = rows;
+    body->cols = cols;
+    SnakeBodyReserve(body, SNAKE_BODY_MIN_CAPACITY);
+    SnakeBodyReset(body, head);
+}
+
+void SnakeBodyFree(SnakeBody *body) {
+    free(body->runs);
+    body->runs = NULL;
+    body->capacity = 0;
+}
+
+void SnakeBodyReset(SnakeBody *body, int head) {
+    body->head = head;
+    body->tail = head;
+    body->length = 0;
+    body->pendingGrowth = 0;
+    body->first = 0;
+    body->runCount = 0;
+}
+
+void SnakeBodyCopy(SnakeBody *dst, const SnakeBody *src) {
+    SnakeBodyReserve(dst, src->runCount);
+
+    for (int i = 0; i < src->runCount; i++) {
+        dst->runs[i] = *SnakeBodyGetRun(src, i);
+    }
+
+    dst->rows = src->rows;
+    dst->cols = src->cols;
+    dst->head = src->head;
+    dst->tail = src->tail;
+    dst->length = src->length;
+    dst->pendingGrowth = src->pendingGrowth;
+    dst->first = 0;
+    dst->runCount = src->runCount;
+}
+
+int SnakeBodyMove(SnakeBody *body, int direction) {
+    int oldHead = body->head;
+    SnakeRun *front = body->runCount > 0 ? SnakeBodyGetRun(body, 0) : NULL;
+
+    // The old head becomes the first segment
+    if (front != NULL && front->direction == direction) {
+        front->length++;
+    } else {
+        SnakeBodyReserve(body, body->runCount + 1);
+        body->first = (body->first - 1) & (body->capacity - 1);
+        body->runCount++;
+
+        SnakeRun *run = SnakeBodyGetRun(body, 0);
+        run->length = 1;
+        run->direction = (uint8_t) direction;
+    }
+
+    body->head = SnakeBodyStep(body, oldHead, direction, 1);
+    body->length++;
+
+    if (body->pendingGrowth > 0) {
+        body->pendingGrowth--;
+
+        if (body->length == 1) {
+            body->tail = oldHead;
+        }
+
+        return -1;
+    }
+
+    // The last segment drops, the one before it is one step toward the head
+    int leftCell = body->tail;
+    SnakeRun *back = SnakeBodyGetRun(body, body->runCount - 1);
+
+    body->tail = SnakeBodyStep(body, body->tail, back->direction, 1);
+    body->length--;
+
+    if (--back->length == 0) {
+        body->runCount--;
+    }
+
+    if (body->length == 0) {
+        body->tail = body->head;
+    }
+
+    return leftCell;
+}
+
+void SnakeBodyBegin(SnakeBodyCursor *cursor, const SnakeBody *body) {
+    cursor->body = body;
+    cursor->run = 0;
+    cursor->offset = 0;
+    cursor->index = -1;
+    cursor->cell = body->head;
+    cursor->direction = -1;
+}
+
+bool SnakeBodyNext(SnakeBodyCursor *cursor) {
+    const SnakeBody *body = cursor->body;
+
+    if (cursor->index + 1 >= body->length) {
+        return false;
+    }
+
+    SnakeRun *run = SnakeBodyGetRun(body, cursor->run);
+
+    if (cursor->offset == (int) run->length) {
+        cursor->run++;
+        cursor->offset = 0;
+        run = SnakeBodyGetRun(body, cursor->run);
+    }
+
+    // Segments are behind the one before them, opposite to their direction
+    cursor->cell = SnakeBodyStep(body, cursor->cell, (run->direction + 2) & 3, 1);
+    cursor->direction = run->direction;
+    cursor->offset++;
+    cursor->index++;
+
+    return true;
+}
+
+int SnakeBodyGetRunLeft(const SnakeBodyCursor *cursor) {
+    return cursor->index < 0 ? 0 : (int) SnakeBodyGetRun(cursor->body, cursor->run)->length - cursor->offset;
+}
+
+void SnakeBodySkip(SnakeBodyCursor *cursor, int count) {
+    int left = SnakeBodyGetRunLeft(cursor);
+
+    count = count < left ? count : left;
+    cursor->cell = SnakeBodyStep(cursor->body, cursor->cell, (cursor->direction + 2) & 3, count);
+    cursor->offset += count;
+    cursor->index += count;
+}
+
+bool SnakeBodyNextSpan(SnakeBodyCursor *cursor, int count, int breakAt, SnakeBodySpan *span) {
+    const SnakeBody *body = cursor->body;
+
+    if (cursor->index + 1 >= count || !SnakeBodyNext(cursor)) {
+        return false;
+    }
+
+    span->first = cursor->index;
+    span->cell = cursor->cell;
+    span->count = 1;
+    span->direction = -1;
+
+    if (cursor->index == body->length - 1) {
+        return true;
+    }
+
+    // A segment moved the way the segment behind it points, which is in the
+    // next run for the last segment of a run
+    int left = SnakeBodyGetRunLeft(cursor);
+    SnakeRun *run = SnakeBodyGetRun(body, left > 0 ? cursor->run : cursor->run + 1);
+    int length = left > 0 ? left : (int) run->length;
+    int edge = SnakeBodyGetEdgeDistance(body, cursor->cell, (run->direction + 2) & 3) + 1;
+
+    length = length < count - span->first ? length : count - span->first;
+    length = length < edge ? length : edge;
+
+    if (span->first < breakAt) {
+        length = length < breakAt - span->first ? length : breakAt - span->first;
+    }
+
+    span->count = length;
+    span->direction = run->direction;
+
+    for (int remaining = length - 1; remaining > 0;) {
+        int skipped = SnakeBodyGetRunLeft(cursor);
+
+        if (skipped > 0) {
+            skipped = skipped < remaining ? skipped : remaining;
+            SnakeBodySkip(cursor, skipped);
+            remaining -= skipped;
+        } else {
+            SnakeBodyNext(cursor);
+            remaining--;
+        }
+    }
+
+    return true;
+}
+
+// Skips whole runs, so it costs the number of turns before the segment
+int SnakeBodyGetCell(const SnakeBody *body, int index) {
+    int cell = body->head;
+
+    for (int i = 0; i < body->runCount; i++) {
+        SnakeRun *run = SnakeBodyGetRun(body, i);
+        int steps = index < (int) run->length ? index + 1 : (int) run->length;
+
+        cell = SnakeBodyStep(body, cell, (run->direction + 2) & 3, steps);
+        index -= steps;
+
+        if (index < 0) {
+            break;
+        }
+    }
+
+    return cell;
+}
+
+int SnakeBodyGetCells(const SnakeBody *body, int *cells) {
+    SnakeBodyCursor cursor;
+
+    SnakeBodyBegin(&cursor, body);
+
+    while (SnakeBodyNext(&cursor)) {
+        cells[cursor.index] = cursor.cell;
+    }
+
+    return body->length;
+}
+
+size_t SnakeBodyGetMemory(const SnakeBody *body) {
+    return sizeof(SnakeBody) + sizeof(SnakeRun) * body->capacity;
+}
@@ -0,0 +1,93 @@
+/**
+ * Snake body stored as straight runs instead of one entry per segment.
+ *
+ * The body is kept from the head to the tail as a ring of runs, each a
+ * direction and a number of segments. A move only touches the run at each
+ * end, and memory follows the number of turns rather than the length: a
+ * million segment snake with a hundred turns takes about a kilobyte.
+ *
+ * Segment cells are derived when needed by walking the runs with a
+ * SnakeBodyCursor. Growth that is not laid out yet is a counter like in
+ * SimState, the segments are added on the next moves. Which cells are under
+ * the body is not answered here, the game keeps a collision grid up to date
+ * from the cells SnakeBodyMove reports.
+ *
+ * For drawing, SnakeBodyNextSpan groups the segments that moved the same
+ * way on the last move, each group is one straight quad sliding along its
+ * direction, so only its two ends need to be placed.
+*/
+#ifndef SNAKEBODY_H
+#define SNAKEBODY_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+typedef struct SnakeRun
+{
+    uint32_t length;
+    uint8_t direction;  // SimDirection from every segment of the run to the one before it
+} SnakeRun;
+
+typedef struct SnakeBody
+{
+    int rows;
+    int cols;
+    int head;           // Cell index (row * cols + col)
+    int tail;           // Last body cell, the head when there is no body
+    int length;         // Body segments behind the head
+    int pendingGrowth;  // Segments added on the next moves
+
+    SnakeRun *runs;     // Ring, the run at first touches the head
+    int first;
+    int runCount;
+    int capacity;       // Power of two
+} SnakeBody;
+
+typedef struct SnakeBodyCursor
+{
+    const SnakeBody *body;
+    int run;            // Runs walked past from the head
+    int offset;         // Segments walked in the current run
+    int index;          // Segment under the cursor, -1 on the head
+    int cell;
+    int direction;      // Of the segment under the cursor, -1 on the head
+} SnakeBodyCursor;
+
+typedef struct SnakeBodySpan
+{
+    int first;          // Segment nearest the head
+    int count;
+    int cell;           // Of the first segment, the others follow away from the head
+    int direction;      // Every segment moved one step this way, -1 for the last segment
+} SnakeBodySpan;
+
+void SnakeBodyInit(SnakeBody *body, int rows, int cols, int head);
+void SnakeBodyFree(SnakeBody *body);
+void SnakeBodyReset(SnakeBody *body, int head);
+
+// Copies src into dst, which keeps its own runs, only the used runs are copied
+void SnakeBodyCopy(SnakeBody *dst, const SnakeBody *src);
+
+// Moves the head to its neighbor in direction and the tail after it unless
+// growth is pending. Returns the cell the tail left, -1 when the body grew.
+int SnakeBodyMove(SnakeBody *body, int direction);
+
+void SnakeBodyBegin(SnakeBodyCursor *cursor, const SnakeBody *body);
+bool SnakeBodyNext(SnakeBodyCursor *cursor);
+
+// Segments after the cursor in its run, skipping them costs one step
+int SnakeBodyGetRunLeft(const SnakeBodyCursor *cursor);
+void SnakeBodySkip(SnakeBodyCursor *cursor, int count);
+
+// Next span of the first count segments, the cursor is left on its last
+// segment. Spans never cross a board edge and end before segment breakAt.
+// The last segment of the body is a span of its own, where it came from is
+// only known to the caller.
+bool SnakeBodyNextSpan(SnakeBodyCursor *cursor, int count, int breakAt, SnakeBodySpan *span);
+
+int SnakeBodyGetCell(const SnakeBody *body, int index);
+int SnakeBodyGetCells(const SnakeBody *body, int *cells);
+size_t SnakeBodyGetMemory(const SnakeBody *body);
+
+#endif
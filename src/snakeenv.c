@@ -0,0 +1,135 @@
+#include "snakeenv.h"
+#include "stdlib.h"
+#include "sim.h"
+#include "observe.h"
+
+struct SnakeEnv
+{
+    SimTileMap *tileMap;
+    SimState state;
+    int ticksSinceApple;
+    int starveTicks;     // The episode ends after this many ticks without an apple
+    bool isDone;
+};
+
+int SnakeEnvGetVersion(void) {
+    return SNAKE_ENV_VERSION;
+}
+
+SnakeEnv* SnakeEnvCreate(int rows, int cols, uint64_t seed) {
+    if (rows < 2 || cols < 2 || rows * cols > 1 << 20) {
+        return NULL;
+    }
+
+    TileMap tileMap = {.rows = rows, .cols = cols, .tileWidth = 1, .tileHeight = 1};
+    tileMap.tiles = (TileValue*) calloc(rows * cols, sizeof(TileValue));
+
+    SnakeEnv *env = (SnakeEnv*) malloc(sizeof(SnakeEnv));
+    env->tileMap = SimTileMapCreate(&tileMap);
+    env->state.tileMap = NULL;
+    env->starveTicks = rows * cols * 2;
+    free(tileMap.tiles);
+
+    SnakeEnvReset(env, seed);
+
+    return env;
+}
+
+void SnakeEnvDestroy(SnakeEnv *env) {
+    if (env == NULL) {
+        return;
+    }
+
+    SimRelease(&env->state);
+    SimTileMapRelease(env->tileMap);
+    free(env);
+}
+
+void SnakeEnvReset(SnakeEnv *env, uint64_t seed) {
+    const TileMap *tileMap = &env->tileMap->tileMap;
+    uint64_t rng = seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+    int cell = SimRandom(&rng) % (tileMap->rows * tileMap->cols);
+    TilePosition head = {.row = cell / tileMap->cols, .col = cell % tileMap->cols};
+
+    SimRelease(&env->state);
+    SimInit(&env->state, env->tileMap, head, SimRandom(&rng));
+    env->ticksSinceApple = 0;
+    env->isDone = false;
+}
+
+int SnakeEnvStep(SnakeEnv *env, int action, float *reward) {
+    if (action < SNAKE_ENV_UP || action > SNAKE_ENV_LEFT) {
+        return -1;
+    }
+
+    float value = 0;
+
+    if (!env->isDone) {
+        int score = env->state.score;
+
+        SimStep(&env->state, action);
+        env->ticksSinceApple++;
+
+        if (env->state.score > score) {
+            value = 1;
+            env->ticksSinceApple = 0;
+        }
+
+        if (env->state.isOver) {
+            value = -1;
+        }
+
+        env->isDone = env->state.isOver || env->ticksSinceApple >= env->starveTicks;
+    }
+
+    if (reward != NULL) {
+        *reward = value;
+    }
+
+    return env->isDone;
+}
+
+void SnakeEnvGetObservationShape(const SnakeEnv *env, int *channels, int *rows, int *cols) {
+    *channels = OBSERVE_PLANE_COUNT;
+    *rows = env->tileMap->tileMap.rows;
+    *cols = env->tileMap->tileMap.cols;
+}
+
+void SnakeEnvObserve(const SnakeEnv *env, void *buffer, int dtype) {
+    if (dtype == SNAKE_ENV_UINT8) {
+        ObserveUint8(&env->state, (uint8_t*) buffer);
+    } else {
+        ObserveFloat(&env->state, (float*) buffer);
+    }
+}
+
+// Every env of a batch must have the same size
+void SnakeEnvObserveBatch(SnakeEnv *const *envs, int count, void *buffer, int dtype) {
+    if (count <= 0) {
+        return;
+    }
+
+    const TileMap *tileMap = &envs[0]->tileMap->tileMap;
+    size_t elementSize = dtype == SNAKE_ENV_UINT8 ? sizeof(uint8_t) : sizeof(float);
+    size_t tensorSize = elementSize * OBSERVE_PLANE_COUNT * tileMap->rows * tileMap->cols;
+
+    for (int i = 0; i < count; i++) {
+        SnakeEnvObserve(envs[i], (char*) buffer + tensorSize * i, dtype);
+    }
+}
+
+int SnakeEnvGetScore(const SnakeEnv *env) {
+    return env->state.score;
+}
+
+int SnakeEnvGetLength(const SnakeEnv *env) {
+    return env->state.length + 1;
+}
+
+int SnakeEnvGetTicks(const SnakeEnv *env) {
+    return env->state.ticks;
+}
+
+uint64_t SnakeEnvGetHash(const SnakeEnv *env) {
+    return SimGetHash(&env->state);
+}
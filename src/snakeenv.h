@@ -0,0 +1,63 @@
+/**
+ * Stable C API of the headless game for reinforcement learning (libsnake).
+ *
+ * Only plain C types cross this boundary so the library can be loaded from
+ * Python ctypes/cffi or any other FFI. SnakeEnv is opaque, new functions may
+ * be added but existing ones keep their signature while SNAKE_ENV_VERSION
+ * stays the same.
+ *
+ * Observations are NCHW: SnakeEnvObserve writes one (channels, rows, cols)
+ * tensor and SnakeEnvObserveBatch writes count of them back to back. The
+ * caller owns the buffer, nothing is allocated after SnakeEnvCreate.
+*/
+#ifndef SNAKEENV_H
+#define SNAKEENV_H
+
+#include "stdint.h"
+
+#if defined(_WIN32)
+#define SNAKE_ENV_API __declspec(dllexport)
+#else
+#define SNAKE_ENV_API __attribute__((visibility("default")))
+#endif
+
+#define SNAKE_ENV_VERSION 1
+
+typedef struct SnakeEnv SnakeEnv;
+
+typedef enum SnakeEnvDType
+{
+    SNAKE_ENV_FLOAT32,
+    SNAKE_ENV_UINT8,
+} SnakeEnvDType;
+
+typedef enum SnakeEnvAction
+{
+    SNAKE_ENV_UP,
+    SNAKE_ENV_RIGHT,
+    SNAKE_ENV_DOWN,
+    SNAKE_ENV_LEFT,
+} SnakeEnvAction;
+
+SNAKE_ENV_API int SnakeEnvGetVersion(void);
+
+// Returns NULL when the size is invalid
+SNAKE_ENV_API SnakeEnv* SnakeEnvCreate(int rows, int cols, uint64_t seed);
+SNAKE_ENV_API void SnakeEnvDestroy(SnakeEnv *env);
+
+SNAKE_ENV_API void SnakeEnvReset(SnakeEnv *env, uint64_t seed);
+
+// Returns 1 when the episode is over, 0 when it goes on and -1 for an invalid action.
+// Reward is +1 for an apple, -1 for dying and 0 otherwise.
+SNAKE_ENV_API int SnakeEnvStep(SnakeEnv *env, int action, float *reward);
+
+SNAKE_ENV_API void SnakeEnvGetObservationShape(const SnakeEnv *env, int *channels, int *rows, int *cols);
+SNAKE_ENV_API void SnakeEnvObserve(const SnakeEnv *env, void *buffer, int dtype);
+SNAKE_ENV_API void SnakeEnvObserveBatch(SnakeEnv *const *envs, int count, void *buffer, int dtype);
+
+SNAKE_ENV_API int SnakeEnvGetScore(const SnakeEnv *env);
+SNAKE_ENV_API int SnakeEnvGetLength(const SnakeEnv *env);
+SNAKE_ENV_API int SnakeEnvGetTicks(const SnakeEnv *env);
+SNAKE_ENV_API uint64_t SnakeEnvGetHash(const SnakeEnv *env);
+
+#endif
@@ -0,0 +1,606 @@
+/**
+ * Offline solver that writes the perfect move of every reachable state of a
+ * tiny board, see solver.h.
+ *
+ * 1. Enumeration: level by level breadth first search from the start states
+ *    (head at 1:1, every apple cell). Workers insert successors in one lock
+ *    free open addressing hash set with compare-and-swap. Every apple cell is
+ *    enumerated for each snake shape because the game respawns expired
+ *    apples anywhere.
+ * 2. Retrograde analysis: the snake never shrinks, so states are layered by
+ *    the length they end up with and solved from the longest layer down.
+ *    Inside a layer the apple does not move, a state is worth the best apple
+ *    it can reach and eating is worth 1 plus the average over the apple
+ *    spawns of the next layer, which is already solved. Values are relaxed
+ *    until nothing changes, preferring the closest apple on ties.
+ * 3. The keys and best moves are written as a table the game memory maps.
+ *
+ * Usage: ./build/solve [options]
+ *   --size N          board size, 4 to 6 (default 4)
+ *   --rows N --cols N non square boards
+ *   --max-length N    longest snake solved, eating past it ends the game (default 10)
+ *   --table-bits N    log2 of the hash set slots (default 24)
+ *   --threads N       worker threads (default all cores)
+ *   --verify N        games played from the written table (default 1000)
+ *   --output PATH     (default assets/solver.tbl)
+*/
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "stdatomic.h"
+#include "sim.h"
+#include "solver.h"
+#include "jobs.h"
+#include "clock.h"
+
+#define SOLVE_CHUNK 256
+#define SOLVE_NO_SLOT UINT32_MAX
+#define SOLVE_FAR 0xFFFF   // Distance of states that cannot reach an apple
+#define SOLVE_MIN_SIZE 4
+#define SOLVE_MAX_SIZE 6    // Largest --size the hash set and state keys are sized for
+
+typedef struct SolveWorker
+{
+    SimState *state;
+    SimState *next;
+    uint32_t *found;       // Slots this worker inserted first, the next frontier
+    size_t foundCount;
+    size_t foundCapacity;
+    char padding[64];
+} SolveWorker;
+
+typedef struct Solver
+{
+    SimTileMap *tileMap;
+    int cellCount;
+    int maxLength;
+    int startCell;
+
+    _Atomic uint64_t *keys;
+    uint64_t capacity;
+    atomic_ullong count;
+    atomic_bool isFull;
+
+    // Best value, distance to the apple and move, packed by SolvePack
+    _Atomic uint64_t *entries;
+
+    uint32_t *frontier;
+    size_t frontierCount;
+    uint32_t *layer;       // Slots of the layer being solved
+    size_t layerCount;
+    uint32_t *successors;  // Slot after each walking move of the layer states
+    atomic_bool isChanged;
+
+    SolveWorker *workers;
+} Solver;
+
+static uint64_t SolvePack(float value, int distance, int move) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return ((uint64_t) bits << 32) | ((uint64_t) distance << 8) | (uint8_t) move;
+}
+
+static float SolveGetValue(uint64_t entry) {
+    uint32_t bits = entry >> 32;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static int SolveGetDistance(uint64_t entry) {
+    return (entry >> 8) & 0xFFFF;
+}
+
+// Values are never negative, so a greater value or a closer apple is better
+static bool SolveIsBetter(uint64_t entry, uint64_t other) {
+    float value = SolveGetValue(entry);
+    float otherValue = SolveGetValue(other);
+    return value > otherValue || (value == otherValue && SolveGetDistance(entry) < SolveGetDistance(other));
+}
+
+static uint32_t SolveFind(Solver *solver, uint64_t key) {
+    uint64_t mask = solver->capacity - 1;
+
+    for (uint64_t slot = SolverHashKey(key) & mask; ; slot = (slot + 1) & mask) {
+        uint64_t current = atomic_load_explicit(&solver->keys[slot], memory_order_relaxed);
+
+        if (current == key) {
+            return (uint32_t) slot;
+        } else if (current == SOLVER_EMPTY_KEY) {
+            return SOLVE_NO_SLOT;
+        }
+    }
+}
+
+// Linear probing, a slot is claimed by swapping the empty key for the new key
+static void SolveInsert(Solver *solver, SolveWorker *worker, uint64_t key) {
+    uint64_t mask = solver->capacity - 1;
+
+    for (uint64_t slot = SolverHashKey(key) & mask; ; slot = (slot + 1) & mask) {
+        uint64_t current = atomic_load_explicit(&solver->keys[slot], memory_order_relaxed);
+
+        if (current == SOLVER_EMPTY_KEY) {
+            if (atomic_compare_exchange_strong_explicit(&solver->keys[slot], &current, key, memory_order_relaxed, memory_order_relaxed)) {
+                // Keep a tenth of the slots empty so probes stay short and always end
+                if (atomic_fetch_add_explicit(&solver->count, 1, memory_order_relaxed) >= solver->capacity / 10 * 9) {
+                    atomic_store(&solver->isFull, true);
+                }
+
+                if (worker->foundCount == worker->foundCapacity) {
+                    worker->foundCapacity = worker->foundCapacity > 0 ? worker->foundCapacity * 2 : 4096;
+                    worker->found = (uint32_t*) realloc(worker->found, sizeof(uint32_t) * worker->foundCapacity);
+                }
+
+                worker->found[worker->foundCount++] = (uint32_t) slot;
+                return;
+            }
+        }
+
+        // Another worker may have claimed the slot with the same key
+        if (current == key) {
+            return;
+        }
+    }
+}
+
+static bool SolveIsCellFree(const SimState *state, int cell) {
+    return state->tileMap->tileMap.tiles[cell] != TILE_WALL && cell != state->head && !SimIsBodyAt(state, cell);
+}
+
+// The same snake with every possible apple
+static void SolveInsertApples(Solver *solver, SolveWorker *worker, SimState *state) {
+    int appleCell = state->appleCell;
+
+    for (int cell = 0; cell < solver->cellCount; cell++) {
+        if (SolveIsCellFree(state, cell)) {
+            state->appleCell = cell;
+            SolveInsert(solver, worker, SolverEncode(state));
+        }
+    }
+
+    state->appleCell = appleCell;
+}
+
+static void SolveExpand(void *data, int workerIndex, uint32_t job) {
+    Solver *solver = (Solver*) data;
+    SolveWorker *worker = &solver->workers[workerIndex];
+    size_t end = (size_t) (job + 1) * SOLVE_CHUNK < solver->frontierCount ? (size_t) (job + 1) * SOLVE_CHUNK : solver->frontierCount;
+
+    for (size_t i = (size_t) job * SOLVE_CHUNK; i < end && !atomic_load_explicit(&solver->isFull, memory_order_relaxed); i++) {
+        uint64_t key = atomic_load_explicit(&solver->keys[solver->frontier[i]], memory_order_relaxed);
+
+        SolverDecode(key, solver->tileMap, worker->state);
+        SolveInsertApples(solver, worker, worker->state);
+
+        for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+            SimFork(worker->next, worker->state);
+            SimStep(worker->next, direction);
+
+            if (worker->next->isOver || worker->next->appleCell < 0) {
+                // Dead, or the board is full
+            } else if (worker->next->score > 0) {
+                if (SolverGetKeyLength(SolverEncode(worker->next)) <= solver->maxLength) {
+                    SolveInsertApples(solver, worker, worker->next);
+                }
+            } else {
+                SolveInsert(solver, worker, SolverEncode(worker->next));
+            }
+
+            SimRelease(worker->next);
+        }
+
+        SimRelease(worker->state);
+    }
+}
+
+// Value of eating: one apple plus the average of the next layer over the apple spawns
+static float SolveEatValue(Solver *solver, SimState *state) {
+    if (state->appleCell < 0 || SolverGetKeyLength(SolverEncode(state)) > solver->maxLength) {
+        return 1;
+    }
+
+    double sum = 0;
+    int count = 0;
+
+    for (int cell = 0; cell < solver->cellCount; cell++) {
+        if (SolveIsCellFree(state, cell)) {
+            state->appleCell = cell;
+
+            uint32_t slot = SolveFind(solver, SolverEncode(state));
+
+            if (slot != SOLVE_NO_SLOT) {
+                sum += SolveGetValue(atomic_load_explicit(&solver->entries[slot], memory_order_relaxed));
+            }
+
+            count++;
+        }
+    }
+
+    return (float) (1 + sum / count);
+}
+
+// First look at every move: eating moves get their final value, walking moves their successor
+static void SolveInitLayer(void *data, int workerIndex, uint32_t job) {
+    Solver *solver = (Solver*) data;
+    SolveWorker *worker = &solver->workers[workerIndex];
+    size_t end = (size_t) (job + 1) * SOLVE_CHUNK < solver->layerCount ? (size_t) (job + 1) * SOLVE_CHUNK : solver->layerCount;
+
+    for (size_t i = (size_t) job * SOLVE_CHUNK; i < end; i++) {
+        uint32_t slot = solver->layer[i];
+        uint64_t best = SolvePack(0, SOLVE_FAR, SOLVER_NO_MOVE);
+
+        SolverDecode(atomic_load_explicit(&solver->keys[slot], memory_order_relaxed), solver->tileMap, worker->state);
+
+        for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+            SimState *next = worker->next;
+
+            solver->successors[i * 4 + direction] = SOLVE_NO_SLOT;
+
+            SimFork(next, worker->state);
+            SimStep(next, direction);
+
+            if (!next->isOver) {
+                uint64_t candidate;
+
+                if (next->score > 0) {
+                    candidate = SolvePack(SolveEatValue(solver, next), 1, direction);
+                } else {
+                    solver->successors[i * 4 + direction] = SolveFind(solver, SolverEncode(next));
+                    candidate = SolvePack(0, SOLVE_FAR, direction);
+                }
+
+                // A move that does not die beats dying even when no apple is reachable
+                if ((best & 0xFF) == SOLVER_NO_MOVE || SolveIsBetter(candidate, best)) {
+                    best = candidate;
+                }
+            }
+
+            SimRelease(next);
+        }
+
+        atomic_store_explicit(&solver->entries[slot], best, memory_order_relaxed);
+        SimRelease(worker->state);
+    }
+}
+
+// One relaxation pass, updated in place so good values spread faster
+static void SolveRelaxLayer(void *data, int workerIndex, uint32_t job) {
+    Solver *solver = (Solver*) data;
+    size_t end = (size_t) (job + 1) * SOLVE_CHUNK < solver->layerCount ? (size_t) (job + 1) * SOLVE_CHUNK : solver->layerCount;
+    bool isChanged = false;
+
+    for (size_t i = (size_t) job * SOLVE_CHUNK; i < end; i++) {
+        uint32_t slot = solver->layer[i];
+        uint64_t best = atomic_load_explicit(&solver->entries[slot], memory_order_relaxed);
+        uint64_t previous = best;
+
+        for (int direction = SIM_UP; direction <= SIM_LEFT; direction++) {
+            uint32_t successor = solver->successors[i * 4 + direction];
+
+            if (successor == SOLVE_NO_SLOT) {
+                continue;
+            }
+
+            uint64_t entry = atomic_load_explicit(&solver->entries[successor], memory_order_relaxed);
+            int distance = SolveGetDistance(entry) < SOLVE_FAR ? SolveGetDistance(entry) + 1 : SOLVE_FAR;
+            uint64_t candidate = SolvePack(SolveGetValue(entry), distance, direction);
+
+            if (SolveIsBetter(candidate, best)) {
+                best = candidate;
+            }
+        }
+
+        if (best != previous) {
+            atomic_store_explicit(&solver->entries[slot], best, memory_order_relaxed);
+            isChanged = true;
+        }
+    }
+
+    if (isChanged) {
+        atomic_store(&solver->isChanged, true);
+    }
+}
+
+// Rehashed into the smallest power of two at least twice the state count so the file stays small
+static bool SolveWriteTable(Solver *solver, int rows, int cols, const char *path) {
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    uint64_t count = atomic_load(&solver->count);
+    uint64_t capacity = 1024;
+
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+
+    SolverHeader header = {SOLVER_MAGIC, rows, cols, solver->maxLength, capacity, count};
+    uint64_t *keys = (uint64_t*) malloc(sizeof(uint64_t) * capacity);
+    uint8_t *moves = (uint8_t*) malloc(capacity);
+
+    memset(keys, 0xFF, sizeof(uint64_t) * capacity);
+
+    for (uint64_t slot = 0; slot < solver->capacity; slot++) {
+        uint64_t key = solver->keys[slot];
+
+        if (key == SOLVER_EMPTY_KEY) {
+            continue;
+        }
+
+        uint64_t target = SolverHashKey(key) & (capacity - 1);
+
+        while (keys[target] != SOLVER_EMPTY_KEY) {
+            target = (target + 1) & (capacity - 1);
+        }
+
+        keys[target] = key;
+        moves[target] = (uint8_t) atomic_load_explicit(&solver->entries[slot], memory_order_relaxed);
+    }
+
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(keys, sizeof(uint64_t), capacity, file) == capacity &&
+        fwrite(moves, 1, capacity, file) == capacity;
+
+    free(keys);
+    free(moves);
+
+    return fclose(file) == 0 && isWritten;
+}
+
+// Plays games with the table the game would load and compares with the solved value
+static void SolveVerify(Solver *solver, const char *path, int games) {
+    SolverTable table;
+    SimState *state = (SimState*) malloc(sizeof(SimState));
+    TilePosition start = {.row = solver->startCell / solver->tileMap->tileMap.cols, .col = solver->startCell % solver->tileMap->tileMap.cols};
+    double expected = 0;
+    long long apples = 0;
+    int missing = 0;
+
+    if (!SolverTableOpen(&table, path)) {
+        fprintf(stderr, "Cannot map %s\n", path);
+        free(state);
+        return;
+    }
+
+    for (int game = 0; game < games; game++) {
+        SimInit(state, solver->tileMap, start, game + 1);
+        expected += SolveGetValue(atomic_load(&solver->entries[SolveFind(solver, SolverEncode(state))]));
+
+        while (!state->isOver && state->appleCell >= 0 && SolverGetKeyLength(SolverEncode(state)) <= solver->maxLength && state->ticks < 100000) {
+            int direction = SolverTableGetMove(&table, state);
+
+            if (direction < 0) {
+                missing++;
+                break;
+            }
+
+            SimStep(state, direction);
+        }
+
+        apples += state->score / SIM_APPLE_SCORE;
+        SimRelease(state);
+    }
+
+    printf("verify games=%d apples=%.3f expected=%.3f missing=%d\n", games, (double) apples / games, expected / games, missing);
+
+    SolverTableClose(&table);
+    free(state);
+}
+
+int main(int argc, char **argv) {
+    Solver solver = {.maxLength = 10};
+    int rows = 4;
+    int cols = 4;
+    int tableBits = 24;
+    int threadCount = ClockGetCoreCount();
+    int verifyGames = 1000;
+    const char *outputPath = "assets/solver.tbl";
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--size") == 0) {
+            rows = cols = atoi(value);
+
+            if (rows < SOLVE_MIN_SIZE || rows > SOLVE_MAX_SIZE) {
+                fprintf(stderr, "Board size must be %d to %d\n", SOLVE_MIN_SIZE, SOLVE_MAX_SIZE);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--rows") == 0) {
+            rows = atoi(value);
+        } else if (strcmp(argv[i], "--cols") == 0) {
+            cols = atoi(value);
+        } else if (strcmp(argv[i], "--max-length") == 0) {
+            solver.maxLength = atoi(value);
+        } else if (strcmp(argv[i], "--table-bits") == 0) {
+            tableBits = atoi(value);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threadCount = atoi(value);
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verifyGames = atoi(value);
+        } else if (strcmp(argv[i], "--output") == 0) {
+            outputPath = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+
+        i++;
+    }
+
+    if (rows < 2 || cols < 2 || rows * cols > SOLVER_MAX_CELLS || solver.maxLength < 1 || solver.maxLength > SOLVER_MAX_LENGTH ||
+        solver.maxLength > rows * cols || tableBits < 10 || tableBits > 32 || threadCount <= 0) {
+        fprintf(stderr, "Invalid options\n");
+        return 1;
+    }
+
+    TileMap tileMap = {.rows = rows, .cols = cols, .tileWidth = 1, .tileHeight = 1};
+    tileMap.tiles = (TileValue*) calloc(rows * cols, sizeof(TileValue));
+
+    solver.tileMap = SimTileMapCreate(&tileMap);
+    solver.cellCount = rows * cols;
+    solver.startCell = 1 * cols + 1; // Where the game starts
+    solver.capacity = 1ULL << tableBits;
+    solver.keys = (_Atomic uint64_t*) malloc(sizeof(uint64_t) * solver.capacity);
+    solver.workers = (SolveWorker*) calloc(threadCount, sizeof(SolveWorker));
+    atomic_init(&solver.count, 0);
+    atomic_init(&solver.isFull, false);
+
+    for (uint64_t slot = 0; slot < solver.capacity; slot++) {
+        atomic_init(&solver.keys[slot], SOLVER_EMPTY_KEY);
+    }
+
+    for (int w = 0; w < threadCount; w++) {
+        solver.workers[w].state = (SimState*) malloc(sizeof(SimState));
+        solver.workers[w].next = (SimState*) malloc(sizeof(SimState));
+    }
+
+    size_t memory = sizeof(uint64_t) * solver.capacity * 2;
+    size_t frontierMemory = 0;
+    double start = ClockNow();
+
+    // The start states, one per apple cell
+    TilePosition startPosition = {.row = 1, .col = 1};
+    SimState *state = solver.workers[0].state;
+
+    SimInit(state, solver.tileMap, startPosition, 1);
+    SolveInsertApples(&solver, &solver.workers[0], state);
+    SimRelease(state);
+
+    int depth = 0;
+
+    while (!atomic_load(&solver.isFull)) {
+        size_t frontierCount = 0;
+
+        for (int w = 0; w < threadCount; w++) {
+            frontierCount += solver.workers[w].foundCount;
+        }
+
+        if (frontierCount == 0) {
+            break;
+        }
+
+        free(solver.frontier);
+        solver.frontier = (uint32_t*) malloc(sizeof(uint32_t) * frontierCount);
+        solver.frontierCount = 0;
+
+        for (int w = 0; w < threadCount; w++) {
+            SolveWorker *worker = &solver.workers[w];
+            memcpy(solver.frontier + solver.frontierCount, worker->found, sizeof(uint32_t) * worker->foundCount);
+            solver.frontierCount += worker->foundCount;
+            frontierMemory = frontierMemory > sizeof(uint32_t) * worker->foundCapacity * threadCount * 2 ?
+                frontierMemory : sizeof(uint32_t) * worker->foundCapacity * threadCount * 2;
+            worker->foundCount = 0;
+        }
+
+        JobsRun(threadCount, (uint32_t) ((solver.frontierCount + SOLVE_CHUNK - 1) / SOLVE_CHUNK), SolveExpand, &solver);
+        depth++;
+    }
+
+    double enumerateTime = ClockNow() - start;
+    uint64_t count = atomic_load(&solver.count);
+
+    if (atomic_load(&solver.isFull)) {
+        fprintf(stderr, "Hash set full after %llu states, raise --table-bits or lower --max-length\n", (unsigned long long) count);
+        return 1;
+    }
+
+    printf("enumerate board=%dx%d max-length=%d states=%llu depth=%d threads=%d time=%.2fs\n",
+        rows, cols, solver.maxLength, (unsigned long long) count, depth, threadCount, enumerateTime);
+
+    // Group the slots by layer with a counting sort
+    size_t *layerStarts = (size_t*) calloc(solver.maxLength + 2, sizeof(size_t));
+    uint32_t *order = (uint32_t*) malloc(sizeof(uint32_t) * count);
+
+    for (uint64_t slot = 0; slot < solver.capacity; slot++) {
+        if (solver.keys[slot] != SOLVER_EMPTY_KEY) {
+            layerStarts[SolverGetKeyLength(solver.keys[slot]) + 1]++;
+        }
+    }
+
+    for (int length = 1; length <= solver.maxLength + 1; length++) {
+        layerStarts[length] += layerStarts[length - 1];
+    }
+
+    size_t *layerEnds = (size_t*) malloc(sizeof(size_t) * (solver.maxLength + 2));
+    memcpy(layerEnds, layerStarts, sizeof(size_t) * (solver.maxLength + 2));
+
+    for (uint64_t slot = 0; slot < solver.capacity; slot++) {
+        if (solver.keys[slot] != SOLVER_EMPTY_KEY) {
+            order[layerEnds[SolverGetKeyLength(solver.keys[slot])]++] = (uint32_t) slot;
+        }
+    }
+
+    solver.entries = (_Atomic uint64_t*) calloc(solver.capacity, sizeof(uint64_t));
+    solver.successors = (uint32_t*) malloc(sizeof(uint32_t) * 4 * count);
+    memory += sizeof(uint32_t) * (4 + 1) * count + frontierMemory;
+    start = ClockNow();
+
+    for (int length = solver.maxLength; length >= 1; length--) {
+        int passes = 0;
+
+        solver.layer = order + layerStarts[length];
+        solver.layerCount = layerStarts[length + 1] - layerStarts[length];
+
+        if (solver.layerCount == 0) {
+            continue;
+        }
+
+        uint32_t jobCount = (uint32_t) ((solver.layerCount + SOLVE_CHUNK - 1) / SOLVE_CHUNK);
+
+        JobsRun(threadCount, jobCount, SolveInitLayer, &solver);
+
+        do {
+            atomic_store(&solver.isChanged, false);
+            JobsRun(threadCount, jobCount, SolveRelaxLayer, &solver);
+            passes++;
+        } while (atomic_load(&solver.isChanged));
+
+        printf("layer length=%d states=%zu passes=%d\n", length, solver.layerCount, passes);
+    }
+
+    double solveTime = ClockNow() - start;
+
+    printf("solve time=%.2fs memory=%.1fMB\n", solveTime, memory / 1e6);
+
+    if (!SolveWriteTable(&solver, rows, cols, outputPath)) {
+        fprintf(stderr, "Cannot write %s\n", outputPath);
+        return 1;
+    }
+
+    FILE *file = fopen(outputPath, "rb");
+
+    if (file != NULL) {
+        fseek(file, 0, SEEK_END);
+        printf("table %s size=%.1fMB\n", outputPath, ftell(file) / 1e6);
+        fclose(file);
+    }
+
+    if (verifyGames > 0) {
+        SolveVerify(&solver, outputPath, verifyGames);
+    }
+
+    for (int w = 0; w < threadCount; w++) {
+        free(solver.workers[w].state);
+        free(solver.workers[w].next);
+        free(solver.workers[w].found);
+    }
+
+    free(solver.workers);
+    free(solver.frontier);
+    free(solver.successors);
+    free((void*) solver.entries);
+    free((void*) solver.keys);
+    free(order);
+    free(layerStarts);
+    free(layerEnds);
+    SimTileMapRelease(solver.tileMap);
+    free(tileMap.tiles);
+
+    return 0;
+}
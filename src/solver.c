@@ -0,0 +1,178 @@
+#include "solver.h"
+#include "string.h"
+
+#if defined(_WIN32)
+#include "windows.h"
+#else
+#include "fcntl.h"
+#include "unistd.h"
+#include "sys/mman.h"
+#include "sys/stat.h"
+#endif
+
+#define SOLVER_HEAD_SHIFT 0
+#define SOLVER_APPLE_SHIFT 6
+#define SOLVER_GROWTH_SHIFT 12
+#define SOLVER_LENGTH_SHIFT 13
+#define SOLVER_BODY_SHIFT 19
+
+uint64_t SolverEncode(const SimState *state) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+
+    if (tileMap->rows * tileMap->cols > SOLVER_MAX_CELLS || state->appleCell < 0 ||
+        state->pendingGrowth > 1 || state->length >= SOLVER_MAX_LENGTH) {
+        return SOLVER_EMPTY_KEY;
+    }
+
+    uint64_t body = state->length > 0 ? state->body[0] & (~0ULL >> (64 - 2 * state->length)) : 0;
+
+    return ((uint64_t) state->head << SOLVER_HEAD_SHIFT) |
+        ((uint64_t) state->appleCell << SOLVER_APPLE_SHIFT) |
+        ((uint64_t) state->pendingGrowth << SOLVER_GROWTH_SHIFT) |
+        ((uint64_t) state->length << SOLVER_LENGTH_SHIFT) |
+        (body << SOLVER_BODY_SHIFT);
+}
+
+void SolverDecode(uint64_t key, SimTileMap *tileMap, SimState *state) {
+    state->tileMap = SimTileMapRetain(tileMap);
+    state->head = (key >> SOLVER_HEAD_SHIFT) & 63;
+    state->appleCell = (key >> SOLVER_APPLE_SHIFT) & 63;
+    state->pendingGrowth = (key >> SOLVER_GROWTH_SHIFT) & 1;
+    state->length = (key >> SOLVER_LENGTH_SHIFT) & 63;
+    state->body[0] = key >> SOLVER_BODY_SHIFT;
+    state->direction = -1;
+    state->score = 0;
+    state->ticks = 0;
+    state->isOver = false;
+    state->rng = key | 1;
+    state->tail = state->head;
+
+    for (int i = 0; i < state->length; i++) {
+        state->tail = SimNeighbor(&tileMap->tileMap, state->tail, (SimGetSegmentDirection(state, i) + 2) & 3);
+    }
+
+    state->hash = SimComputeHash(state);
+}
+
+// Head, body and pending growth, the length the snake ends up with
+int SolverGetKeyLength(uint64_t key) {
+    return 1 + ((key >> SOLVER_LENGTH_SHIFT) & 63) + ((key >> SOLVER_GROWTH_SHIFT) & 1);
+}
+
+uint64_t SolverHashKey(uint64_t key) {
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+bool SolverTableOpen(SolverTable *table, const char *path) {
+    memset(table, 0, sizeof(SolverTable));
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    HANDLE fileMapping = GetFileSizeEx(file, &size) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+
+    if (fileMapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+
+    table->file = file;
+    table->fileMapping = fileMapping;
+    table->size = (size_t) size.QuadPart;
+    table->mapping = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (table->mapping == NULL) {
+        SolverTableClose(table);
+        return false;
+    }
+#else
+    int file = open(path, O_RDONLY);
+    struct stat info;
+
+    if (file < 0) {
+        return false;
+    }
+
+    if (fstat(file, &info) != 0 || info.st_size < (off_t) sizeof(SolverHeader)) {
+        close(file);
+        return false;
+    }
+
+    table->size = info.st_size;
+    table->mapping = mmap(NULL, table->size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if (table->mapping == MAP_FAILED) {
+        table->mapping = NULL;
+        return false;
+    }
+#endif
+
+    const SolverHeader *header = (const SolverHeader*) table->mapping;
+
+    if (table->size < sizeof(SolverHeader) || header->magic != SOLVER_MAGIC || header->capacity == 0 ||
+        (header->capacity & (header->capacity - 1)) != 0 ||
+        table->size < sizeof(SolverHeader) + header->capacity * (sizeof(uint64_t) + sizeof(uint8_t))) {
+        SolverTableClose(table);
+        return false;
+    }
+
+    table->header = header;
+    table->keys = (const uint64_t*) (header + 1);
+    table->moves = (const uint8_t*) (table->keys + header->capacity);
+
+    return true;
+}
+
+void SolverTableClose(SolverTable *table) {
+#if defined(_WIN32)
+    if (table->mapping != NULL) {
+        UnmapViewOfFile(table->mapping);
+    }
+
+    if (table->fileMapping != NULL) {
+        CloseHandle(table->fileMapping);
+    }
+
+    if (table->file != NULL) {
+        CloseHandle(table->file);
+    }
+#else
+    if (table->mapping != NULL) {
+        munmap(table->mapping, table->size);
+    }
+#endif
+
+    memset(table, 0, sizeof(SolverTable));
+}
+
+int SolverTableGetMove(const SolverTable *table, const SimState *state) {
+    const TileMap *tileMap = &state->tileMap->tileMap;
+
+    if (table->header == NULL || table->header->rows != (uint32_t) tileMap->rows || table->header->cols != (uint32_t) tileMap->cols) {
+        return -1;
+    }
+
+    uint64_t key = SolverEncode(state);
+
+    if (key == SOLVER_EMPTY_KEY) {
+        return -1;
+    }
+
+    uint64_t mask = table->header->capacity - 1;
+
+    for (uint64_t slot = SolverHashKey(key) & mask; table->keys[slot] != SOLVER_EMPTY_KEY; slot = (slot + 1) & mask) {
+        if (table->keys[slot] == key) {
+            return table->moves[slot] != SOLVER_NO_MOVE ? table->moves[slot] : -1;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,62 @@
+/**
+ * Perfect play on tiny boards from a precomputed table.
+ *
+ * A state is packed in 64 bits: head cell, apple cell, pending growth, body
+ * length and the 2 bit body directions of the SimState, so boards up to 64
+ * cells and snakes up to SOLVER_MAX_LENGTH tiles fit. The offline solver
+ * (src/solve.c) enumerates every reachable state and writes the best move of
+ * each one. The table is an open addressing hash table that is memory mapped
+ * as is, so opening it costs nothing and pages are loaded on first lookup.
+ *
+ * File layout: SolverHeader, capacity keys (uint64), capacity moves (uint8).
+*/
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+#include "sim.h"
+
+#define SOLVER_MAGIC 0x314C4F53 // "SOL1"
+#define SOLVER_MAX_CELLS 64
+#define SOLVER_MAX_LENGTH 23     // Head and 22 body segments
+#define SOLVER_EMPTY_KEY UINT64_MAX
+#define SOLVER_NO_MOVE 0xFF      // Every move dies
+
+typedef struct SolverHeader
+{
+    uint32_t magic;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t maxLength;
+    uint64_t capacity;          // Power of two
+    uint64_t count;
+} SolverHeader;
+
+typedef struct SolverTable
+{
+    const SolverHeader *header;
+    const uint64_t *keys;
+    const uint8_t *moves;
+    void *mapping;
+    size_t size;
+#if defined(_WIN32)
+    void *file;
+    void *fileMapping;
+#endif
+} SolverTable;
+
+// SOLVER_EMPTY_KEY when the state does not fit the encoding
+uint64_t SolverEncode(const SimState *state);
+void SolverDecode(uint64_t key, SimTileMap *tileMap, SimState *state);
+int SolverGetKeyLength(uint64_t key);
+uint64_t SolverHashKey(uint64_t key);
+
+bool SolverTableOpen(SolverTable *table, const char *path);
+void SolverTableClose(SolverTable *table);
+
+// -1 when the state is not in the table
+int SolverTableGetMove(const SolverTable *table, const SimState *state);
+
+#endif
@@ -0,0 +1,21 @@
+#include "tilemap.h"
+
+bool GameIsTileValid(TileMap *tileMap, TilePosition tilePosition) {
+    return tilePosition.row >= 0 && tilePosition.row < tileMap->rows && tilePosition.col >= 0 && tilePosition.col < tileMap->cols;
+}
+
+int GameGetTileIndex(TileMap *tileMap, TilePosition tilePosition) {
+    return tilePosition.row * tileMap->cols + tilePosition.col;
+}
+
+int GameGetTileValue(TileMap *tileMap, TilePosition tilePosition) {
+    return tileMap->tiles[tilePosition.row * tileMap->cols + tilePosition.col];
+}
+
+void GameSetTileValue(TileMap *tileMap, TilePosition tilePosition, TileValue value) {
+    tileMap->tiles[tilePosition.row * tileMap->cols + tilePosition.col] = value;
+}
+
+bool GameIsTilePositionEqual(TilePosition tilePositionA, TilePosition tilePositionB) {
+    return tilePositionA.row == tilePositionB.row && tilePositionA.col == tilePositionB.col;
+}
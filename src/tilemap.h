@@ -0,0 +1,37 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include "stdbool.h"
+
+#define GAME_SNAKE_TAIL_MAX_LENGTH 1024
+#define GAME_SNAKE_SHADED_LENGTH 10 // Tail segments drawn lighter and lighter, the ones after share a color
+
+typedef enum TileValue
+{
+    TILE_EMPTY,
+    TILE_WALL,
+    TILE_PLAYER,
+} TileValue;
+
+typedef struct TilePosition
+{
+    int row;
+    int col;
+} TilePosition;
+
+typedef struct TileMap
+{
+    int rows;
+    int cols;
+    TileValue *tiles;
+    float tileWidth;
+    float tileHeight;
+} TileMap;
+
+bool GameIsTileValid(TileMap *tileMap, TilePosition tilePosition);
+int GameGetTileIndex(TileMap *tileMap, TilePosition tilePosition);
+int GameGetTileValue(TileMap *tileMap, TilePosition tilePosition);
+void GameSetTileValue(TileMap *tileMap, TilePosition tilePosition, TileValue value);
+bool GameIsTilePositionEqual(TilePosition tilePositionA, TilePosition tilePositionB);
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * Plays headless games for every policy and prints a summary per policy.
+ *
+ * Usage: ./build/tournament [options]
+ *   --games N         games per policy (default 10000)
+ *   --policies LIST   comma separated, default all (random,greedy,bfs,hamilton,neural)
+ *                     a policy that can't be created (neural without weights) is skipped
+ *   --size N          board size (default 20)
+ *   --max-ticks N     ticks before a game is stopped (default 100000)
+ *   --threads N       worker threads (default all cores)
+ *   --seed N          base seed (default 1)
+ *   --format csv|json (default csv)
+*/
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "sim.h"
+#include "policy.h"
+#include "jobs.h"
+#include "clock.h"
+
+#define TOURNAMENT_MAX_POLICIES 16
+
+typedef struct TournamentStats
+{
+    long long games;
+    long long score;
+    long long length;
+    long long ticks;
+    long long apples;
+    long long wins;
+    double seconds;     // Game time, the snake speeds up with every apple like in the game
+} TournamentStats;
+
+typedef struct TournamentWorker
+{
+    SimState *state;
+    void *contexts[TOURNAMENT_MAX_POLICIES];
+    TournamentStats stats[TOURNAMENT_MAX_POLICIES];
+    char padding[64];
+} TournamentWorker;
+
+typedef struct Tournament
+{
+    const Policy *policies[TOURNAMENT_MAX_POLICIES];
+    int policyCount;
+    int maxTicks;
+    uint64_t seed;
+    SimTileMap *tileMap;
+    TournamentWorker *workers;
+} Tournament;
+
+static uint64_t TournamentSeed(uint64_t seed, uint32_t game) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ULL + game + 1;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static void TournamentPlay(void *data, int workerIndex, uint32_t job) {
+    Tournament *tournament = (Tournament*) data;
+    TournamentWorker *worker = &tournament->workers[workerIndex];
+    int policyIndex = job % tournament->policyCount;
+    uint32_t game = job / tournament->policyCount;
+    const Policy *policy = tournament->policies[policyIndex];
+    void *context = worker->contexts[policyIndex];
+    SimState *state = worker->state;
+    TilePosition start = {.row = 1, .col = 1};
+    uint64_t seed = TournamentSeed(tournament->seed, game);
+    uint64_t rng = seed ^ 0xD1B54A32D192ED03ULL;
+    double seconds = 0;
+
+    // Every policy plays the same apple sequence for a given game number
+    SimInit(state, tournament->tileMap, start, seed);
+
+    while (!state->isOver && state->ticks < tournament->maxTicks && state->appleCell >= 0) {
+        seconds += 1.0 / (5 + state->score / SIM_APPLE_SCORE);
+        SimStep(state, policy->move(context, state, &rng));
+    }
+
+    TournamentStats *stats = &worker->stats[policyIndex];
+    stats->games++;
+    stats->score += state->score;
+    stats->length += state->length + 1;
+    stats->ticks += state->ticks;
+    stats->apples += state->score / SIM_APPLE_SCORE;
+    stats->wins += state->appleCell < 0;
+    stats->seconds += seconds;
+
+    SimRelease(state);
+}
+
+static int TournamentParsePolicies(Tournament *tournament, const char *list) {
+    char buffer[256];
+    strncpy(buffer, list, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    tournament->policyCount = 0;
+
+    for (char *name = strtok(buffer, ","); name != NULL; name = strtok(NULL, ",")) {
+        const Policy *policy = PolicyFind(name);
+
+        if (policy == NULL) {
+            fprintf(stderr, "Unknown policy %s\n", name);
+            return -1;
+        }
+
+        if (tournament->policyCount < TOURNAMENT_MAX_POLICIES) {
+            tournament->policies[tournament->policyCount++] = policy;
+        }
+    }
+
+    return tournament->policyCount;
+}
+
+int main(int argc, char **argv) {
+    Tournament tournament = {.maxTicks = 100000, .seed = 1};
+    long long games = 10000;
+    int size = 20;
+    int threadCount = ClockGetCoreCount();
+    const char *format = "csv";
+
+    for (int i = 0; i < policyCount; i++) {
+        tournament.policies[tournament.policyCount++] = &policies[i];
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--games") == 0) {
+            games = atoll(value);
+        } else if (strcmp(argv[i], "--policies") == 0) {
+            if (TournamentParsePolicies(&tournament, value) <= 0) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--size") == 0) {
+            size = atoi(value);
+        } else if (strcmp(argv[i], "--max-ticks") == 0) {
+            tournament.maxTicks = atoi(value);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threadCount = atoi(value);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            tournament.seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--format") == 0) {
+            format = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+
+        i++;
+    }
+
+    if (size < 4 || games <= 0 || games * tournament.policyCount > UINT32_MAX || threadCount <= 0) {
+        fprintf(stderr, "Invalid options\n");
+        return 1;
+    }
+
+    TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+    tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+    tournament.tileMap = SimTileMapCreate(&tileMap);
+
+    // Drop policies that can't run here so they don't show up as a row of some other policy's games
+    int runnableCount = 0;
+
+    for (int p = 0; p < tournament.policyCount; p++) {
+        void *context = tournament.policies[p]->create(&tournament.tileMap->tileMap);
+
+        if (context == NULL) {
+            fprintf(stderr, "Skipping policy %s, it could not be created\n", tournament.policies[p]->name);
+            continue;
+        }
+
+        tournament.policies[p]->destroy(context);
+        tournament.policies[runnableCount++] = tournament.policies[p];
+    }
+
+    tournament.policyCount = runnableCount;
+
+    if (tournament.policyCount == 0) {
+        fprintf(stderr, "No policy to run\n");
+        return 1;
+    }
+    tournament.workers = (TournamentWorker*) calloc(threadCount, sizeof(TournamentWorker));
+
+    for (int w = 0; w < threadCount; w++) {
+        tournament.workers[w].state = (SimState*) malloc(sizeof(SimState));
+
+        for (int p = 0; p < tournament.policyCount; p++) {
+            tournament.workers[w].contexts[p] = tournament.policies[p]->create(&tournament.tileMap->tileMap);
+        }
+    }
+
+    double start = ClockNow();
+    JobsRun(threadCount, (uint32_t) (games * tournament.policyCount), TournamentPlay, &tournament);
+    double elapsed = ClockNow() - start;
+
+    bool isJson = strcmp(format, "json") == 0;
+
+    if (isJson) {
+        printf("[\n");
+    } else {
+        printf("policy,games,avg_score,avg_length,avg_survival_ticks,apples_per_minute,wins\n");
+    }
+
+    for (int p = 0; p < tournament.policyCount; p++) {
+        TournamentStats total = {0};
+
+        for (int w = 0; w < threadCount; w++) {
+            TournamentStats *stats = &tournament.workers[w].stats[p];
+            total.games += stats->games;
+            total.score += stats->score;
+            total.length += stats->length;
+            total.ticks += stats->ticks;
+            total.apples += stats->apples;
+            total.wins += stats->wins;
+            total.seconds += stats->seconds;
+        }
+
+        double averageScore = (double) total.score / total.games;
+        double averageLength = (double) total.length / total.games;
+        double averageTicks = (double) total.ticks / total.games;
+        double applesPerMinute = total.seconds > 0 ? total.apples / (total.seconds / 60) : 0;
+
+        if (isJson) {
+            printf("  {\"policy\": \"%s\", \"games\": %lld, \"avg_score\": %.2f, \"avg_length\": %.2f, \"avg_survival_ticks\": %.1f, \"apples_per_minute\": %.2f, \"wins\": %lld}%s\n",
+                tournament.policies[p]->name, total.games, averageScore, averageLength, averageTicks, applesPerMinute, total.wins,
+                p + 1 < tournament.policyCount ? "," : "");
+        } else {
+            printf("%s,%lld,%.2f,%.2f,%.1f,%.2f,%lld\n",
+                tournament.policies[p]->name, total.games, averageScore, averageLength, averageTicks, applesPerMinute, total.wins);
+        }
+    }
+
+    if (isJson) {
+        printf("]\n");
+    }
+
+    fprintf(stderr, "%lld games on %d threads in %.2fs (%.0f games/s)\n",
+        games * tournament.policyCount, threadCount, elapsed, games * tournament.policyCount / elapsed);
+
+    for (int w = 0; w < threadCount; w++) {
+        for (int p = 0; p < tournament.policyCount; p++) {
+            tournament.policies[p]->destroy(tournament.workers[w].contexts[p]);
+        }
+
+        free(tournament.workers[w].state);
+    }
+
+    free(tournament.workers);
+    SimTileMapRelease(tournament.tileMap);
+    free(tileMap.tiles);
+
+    return 0;
+}
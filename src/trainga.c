@@ -0,0 +1,433 @@
+/**
+ * Evolves the weights of the neural policy with a genetic algorithm.
+ *
+ * Every generation each individual plays the same set of headless games,
+ * in parallel with JobsRun, and the next population is bred from the best
+ * ones. Game and mutation seeds only depend on --seed, the generation and
+ * the individual index, so a run gives the same result on any thread count
+ * and after a resume.
+ *
+ * Usage: ./build/train-ga [options]
+ *   --population N    individuals per generation (default 64)
+ *   --generations N   generations to run (default 100)
+ *   --games N         games per individual and generation (default 8)
+ *   --hidden N        hidden units of new networks (default 16)
+ *   --size N          board size of new networks (default 20)
+ *   --max-ticks N     ticks before a game is stopped (default 5000)
+ *   --mutation R      probability to mutate a weight (default 0.02)
+ *   --sigma S         standard deviation of a mutation (default 0.2)
+ *   --threads N       worker threads (default all cores)
+ *   --seed N          base seed (default 1)
+ *   --checkpoint PATH population file written every generation (default build/ga.bin)
+ *   --resume PATH     continue from a checkpoint, its network shape wins
+ *   --output PATH     weights of the best individual (default assets/policy.nn)
+*/
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+#include "sim.h"
+#include "neural.h"
+#include "observe.h"
+#include "jobs.h"
+#include "clock.h"
+
+#define TRAIN_MAGIC 0x32414753 // "SGA2"
+#define TRAIN_TOURNAMENT_SIZE 3
+#define TRAIN_MAX_SIZE 256
+#define TRAIN_MAX_POPULATION (1 << 16)
+#define TRAIN_MAX_GENOME_FLOATS (INT32_MAX / 4)
+
+typedef struct TrainHeader
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t hiddenCount;
+    uint32_t population;
+    uint32_t parameterCount;
+    uint32_t generation;   // Next generation to evaluate
+    uint64_t seed;
+    double bestFitness;    // Of the weights last written to --output, -1 before the first generation
+} TrainHeader;
+
+typedef struct TrainWorker
+{
+    NeuralNet net;
+    SimState *state;
+    char padding[64];
+} TrainWorker;
+
+typedef struct Trainer
+{
+    TrainHeader header;
+    int gameCount;
+    int maxTicks;
+    float mutationRate;
+    float sigma;
+    SimTileMap *tileMap;
+    float *genomes;        // population x parameterCount
+    float *children;
+    double *fitness;
+    TrainWorker *workers;
+} Trainer;
+
+static uint64_t TrainSeed(uint64_t seed, uint64_t a, uint64_t b) {
+    uint64_t x = seed * 0x9E3779B97F4A7C15ULL + a * 0xD1B54A32D192ED03ULL + b + 1;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static float TrainUniform(uint64_t *rng) {
+    return (SimRandom(rng) >> 40) * (1.0f / (1 << 24));
+}
+
+static float TrainGaussian(uint64_t *rng) {
+    float u = TrainUniform(rng);
+    float v = TrainUniform(rng);
+    return sqrtf(-2 * logf(u + 1e-7f)) * cosf(6.2831853f * v);
+}
+
+// Plays every game of one individual, fitness is mostly apples with survival as tie break
+static void TrainEvaluate(void *data, int workerIndex, uint32_t individual) {
+    Trainer *trainer = (Trainer*) data;
+    TrainWorker *worker = &trainer->workers[workerIndex];
+    SimState *state = worker->state;
+    int cellCount = trainer->header.size * trainer->header.size;
+    TilePosition start = {.row = 1, .col = 1};
+    double fitness = 0;
+
+    NeuralSetParameters(&worker->net, trainer->genomes + (size_t) individual * trainer->header.parameterCount);
+
+    for (int game = 0; game < trainer->gameCount; game++) {
+        int ticksSinceApple = 0;
+        int score = 0;
+
+        // Every individual of a generation plays the same apple sequences
+        SimInit(state, trainer->tileMap, start, TrainSeed(trainer->header.seed, trainer->header.generation, game));
+
+        while (!state->isOver && state->ticks < trainer->maxTicks && state->appleCell >= 0 && ticksSinceApple < cellCount * 2) {
+            SimStep(state, NeuralChooseMove(&worker->net, state));
+
+            ticksSinceApple = state->score > score ? 0 : ticksSinceApple + 1;
+            score = state->score;
+        }
+
+        fitness += (double) state->score / SIM_APPLE_SCORE * cellCount + state->ticks;
+        SimRelease(state);
+    }
+
+    trainer->fitness[individual] = fitness / trainer->gameCount;
+}
+
+static int TrainSelect(Trainer *trainer, uint64_t *rng) {
+    int best = SimRandom(rng) % trainer->header.population;
+
+    for (int i = 1; i < TRAIN_TOURNAMENT_SIZE; i++) {
+        int other = SimRandom(rng) % trainer->header.population;
+
+        if (trainer->fitness[other] > trainer->fitness[best]) {
+            best = other;
+        }
+    }
+
+    return best;
+}
+
+// Elitism for the best eighth, uniform crossover and gaussian mutation for the rest
+static void TrainBreed(Trainer *trainer) {
+    int population = trainer->header.population;
+    int parameterCount = trainer->header.parameterCount;
+    int eliteCount = population / 8 > 0 ? population / 8 : 1;
+    int *order = (int*) malloc(sizeof(int) * population);
+
+    for (int i = 0; i < population; i++) {
+        order[i] = i;
+    }
+
+    for (int i = 0; i < eliteCount; i++) {
+        int best = i;
+
+        for (int j = i + 1; j < population; j++) {
+            if (trainer->fitness[order[j]] > trainer->fitness[order[best]]) {
+                best = j;
+            }
+        }
+
+        int swap = order[i];
+        order[i] = order[best];
+        order[best] = swap;
+    }
+
+    for (int child = 0; child < population; child++) {
+        float *genome = trainer->children + (size_t) child * parameterCount;
+
+        if (child < eliteCount) {
+            memcpy(genome, trainer->genomes + (size_t) order[child] * parameterCount, sizeof(float) * parameterCount);
+            continue;
+        }
+
+        uint64_t rng = TrainSeed(trainer->header.seed, trainer->header.generation, 0x100000000ULL + child);
+        const float *a = trainer->genomes + (size_t) TrainSelect(trainer, &rng) * parameterCount;
+        const float *b = trainer->genomes + (size_t) TrainSelect(trainer, &rng) * parameterCount;
+
+        for (int i = 0; i < parameterCount; i++) {
+            uint64_t bits = SimRandom(&rng);
+
+            genome[i] = bits & 1 ? a[i] : b[i];
+
+            if (TrainUniform(&rng) < trainer->mutationRate) {
+                genome[i] += TrainGaussian(&rng) * trainer->sigma;
+            }
+        }
+    }
+
+    float *swap = trainer->genomes;
+    trainer->genomes = trainer->children;
+    trainer->children = swap;
+
+    free(order);
+}
+
+static bool TrainSaveCheckpoint(Trainer *trainer, const char *path) {
+    char temporaryPath[1024];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+
+    FILE *file = fopen(temporaryPath, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    size_t count = (size_t) trainer->header.population * trainer->header.parameterCount;
+    bool isWritten = fwrite(&trainer->header, sizeof(TrainHeader), 1, file) == 1 &&
+        fwrite(trainer->genomes, sizeof(float), count, file) == count;
+
+    // Written next to the old checkpoint and renamed so a crash never leaves half a file
+    if (fclose(file) != 0 || !isWritten) {
+        remove(temporaryPath);
+        return false;
+    }
+
+    // rename replaces the old file atomically on POSIX, Windows needs it gone first
+#if defined(_WIN32)
+    remove(path);
+#endif
+
+    return rename(temporaryPath, path) == 0;
+}
+
+static bool TrainLoadCheckpoint(Trainer *trainer, const char *path) {
+    FILE *file = fopen(path, "rb");
+    TrainHeader header;
+
+    if (file == NULL) {
+        return false;
+    }
+
+    // The shape is checked before anything is allocated from it
+    if (fread(&header, sizeof(TrainHeader), 1, file) != 1 || header.magic != TRAIN_MAGIC ||
+        header.size < 4 || header.size > TRAIN_MAX_SIZE || header.population == 0 || header.population > TRAIN_MAX_POPULATION ||
+        header.hiddenCount > NEURAL_MAX_PARAMETERS ||
+        header.parameterCount != NeuralCountParameters(OBSERVE_PLANE_COUNT * header.size * header.size, header.hiddenCount) ||
+        (uint64_t) header.population * header.parameterCount > TRAIN_MAX_GENOME_FLOATS) {
+        fclose(file);
+        return false;
+    }
+
+    size_t count = (size_t) header.population * header.parameterCount;
+    trainer->genomes = (float*) malloc(sizeof(float) * count);
+
+    bool isRead = fread(trainer->genomes, sizeof(float), count, file) == count;
+
+    fclose(file);
+
+    if (!isRead) {
+        free(trainer->genomes);
+        return false;
+    }
+
+    trainer->header = header;
+
+    return true;
+}
+
+static void TrainInitPopulation(Trainer *trainer, NeuralNet *net) {
+    int parameterCount = trainer->header.parameterCount;
+    trainer->genomes = (float*) malloc(sizeof(float) * trainer->header.population * (size_t) parameterCount);
+
+    for (int individual = 0; individual < (int) trainer->header.population; individual++) {
+        float *genome = trainer->genomes + (size_t) individual * parameterCount;
+        uint64_t rng = TrainSeed(trainer->header.seed, UINT32_MAX, individual);
+        int hiddenWeightCount = net->hiddenCount * net->inputCount;
+        int outputWeightStart = hiddenWeightCount + net->hiddenCount;
+
+        // Scaled by fan in so the hidden units do not all saturate
+        for (int i = 0; i < parameterCount; i++) {
+            float scale = i < hiddenWeightCount ? 1 / sqrtf(net->inputCount) : i >= outputWeightStart ? 1 / sqrtf(net->hiddenCount) : 0;
+            genome[i] = TrainGaussian(&rng) * scale;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    Trainer trainer = {.gameCount = 8, .maxTicks = 5000, .mutationRate = 0.02f, .sigma = 0.2f};
+    int population = 64;
+    int generations = 100;
+    int hiddenCount = 16;
+    int size = 20;
+    int threadCount = ClockGetCoreCount();
+    uint64_t seed = 1;
+    const char *checkpointPath = "build/ga.bin";
+    const char *resumePath = NULL;
+    const char *outputPath = "assets/policy.nn";
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        } else if (strcmp(argv[i], "--population") == 0) {
+            population = atoi(value);
+        } else if (strcmp(argv[i], "--generations") == 0) {
+            generations = atoi(value);
+        } else if (strcmp(argv[i], "--games") == 0) {
+            trainer.gameCount = atoi(value);
+        } else if (strcmp(argv[i], "--hidden") == 0) {
+            hiddenCount = atoi(value);
+        } else if (strcmp(argv[i], "--size") == 0) {
+            size = atoi(value);
+        } else if (strcmp(argv[i], "--max-ticks") == 0) {
+            trainer.maxTicks = atoi(value);
+        } else if (strcmp(argv[i], "--mutation") == 0) {
+            trainer.mutationRate = atof(value);
+        } else if (strcmp(argv[i], "--sigma") == 0) {
+            trainer.sigma = atof(value);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            threadCount = atoi(value);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--checkpoint") == 0) {
+            checkpointPath = value;
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            resumePath = value;
+        } else if (strcmp(argv[i], "--output") == 0) {
+            outputPath = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+
+        i++;
+    }
+
+    if (resumePath != NULL) {
+        if (!TrainLoadCheckpoint(&trainer, resumePath)) {
+            fprintf(stderr, "Cannot resume from %s\n", resumePath);
+            return 1;
+        }
+
+        size = trainer.header.size;
+        hiddenCount = trainer.header.hiddenCount;
+    } else {
+        trainer.header = (TrainHeader) {.magic = TRAIN_MAGIC, .size = size, .hiddenCount = hiddenCount, .population = population, .seed = seed, .bestFitness = -1};
+    }
+
+    NeuralNet net;
+
+    if (size < 4 || size > TRAIN_MAX_SIZE || trainer.header.population < 2 || trainer.header.population > TRAIN_MAX_POPULATION ||
+        generations < 0 || trainer.gameCount <= 0 || threadCount <= 0 ||
+        (uint64_t) trainer.header.population * NeuralCountParameters(OBSERVE_PLANE_COUNT * size * size, hiddenCount) > TRAIN_MAX_GENOME_FLOATS ||
+        !NeuralInit(&net, OBSERVE_PLANE_COUNT * size * size, hiddenCount)) {
+        fprintf(stderr, "Invalid options\n");
+        return 1;
+    }
+
+    if (resumePath != NULL && trainer.header.parameterCount != (uint32_t) NeuralGetParameterCount(&net)) {
+        fprintf(stderr, "Checkpoint %s does not match its network shape\n", resumePath);
+        return 1;
+    }
+
+    if (resumePath == NULL) {
+        trainer.header.parameterCount = NeuralGetParameterCount(&net);
+        TrainInitPopulation(&trainer, &net);
+    }
+
+    TileMap tileMap = {.rows = size, .cols = size, .tileWidth = 1, .tileHeight = 1};
+    tileMap.tiles = (TileValue*) calloc(size * size, sizeof(TileValue));
+    trainer.tileMap = SimTileMapCreate(&tileMap);
+    trainer.children = (float*) malloc(sizeof(float) * trainer.header.population * (size_t) trainer.header.parameterCount);
+    trainer.fitness = (double*) calloc(trainer.header.population, sizeof(double));
+    trainer.workers = (TrainWorker*) calloc(threadCount, sizeof(TrainWorker));
+
+    for (int w = 0; w < threadCount; w++) {
+        NeuralInit(&trainer.workers[w].net, net.inputCount, net.hiddenCount);
+        trainer.workers[w].state = (SimState*) malloc(sizeof(SimState));
+    }
+
+    printf("population=%u parameters=%u board=%dx%d hidden=%d threads=%d generation=%u\n",
+        trainer.header.population, trainer.header.parameterCount, size, size, hiddenCount, threadCount, trainer.header.generation);
+
+    double totalTime = 0;
+    long long totalGames = 0;
+
+    for (int g = 0; g < generations; g++) {
+        double start = ClockNow();
+        JobsRun(threadCount, trainer.header.population, TrainEvaluate, &trainer);
+        double elapsed = ClockNow() - start;
+
+        int bestIndex = 0;
+        double meanFitness = 0;
+
+        for (int i = 0; i < (int) trainer.header.population; i++) {
+            meanFitness += trainer.fitness[i] / trainer.header.population;
+
+            if (trainer.fitness[i] > trainer.fitness[bestIndex]) {
+                bestIndex = i;
+            }
+        }
+
+        long long games = (long long) trainer.header.population * trainer.gameCount;
+        totalGames += games;
+        totalTime += elapsed;
+
+        printf("generation %u best=%.1f mean=%.1f games/s=%.0f\n",
+            trainer.header.generation, trainer.fitness[bestIndex], meanFitness, games / elapsed);
+
+        if (trainer.fitness[bestIndex] > trainer.header.bestFitness) {
+            trainer.header.bestFitness = trainer.fitness[bestIndex];
+            NeuralSetParameters(&net, trainer.genomes + (size_t) bestIndex * trainer.header.parameterCount);
+
+            if (!NeuralSave(&net, outputPath)) {
+                fprintf(stderr, "Cannot write %s\n", outputPath);
+            }
+        }
+
+        TrainBreed(&trainer);
+        trainer.header.generation++;
+
+        if (!TrainSaveCheckpoint(&trainer, checkpointPath)) {
+            fprintf(stderr, "Cannot write %s\n", checkpointPath);
+        }
+    }
+
+    if (totalTime > 0) {
+        fprintf(stderr, "%lld games on %d threads in %.2fs (%.0f games/s)\n", totalGames, threadCount, totalTime, totalGames / totalTime);
+    }
+
+    for (int w = 0; w < threadCount; w++) {
+        NeuralFree(&trainer.workers[w].net);
+        free(trainer.workers[w].state);
+    }
+
+    NeuralFree(&net);
+    free(trainer.workers);
+    free(trainer.genomes);
+    free(trainer.children);
+    free(trainer.fitness);
+    SimTileMapRelease(trainer.tileMap);
+    free(tileMap.tiles);
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "triplebuffer.h"
+
+#define TRIPLE_BUFFER_FRESH 4
+#define TRIPLE_BUFFER_SLOT 3
+
+void TripleBufferInit(TripleBuffer *buffer) {
+    buffer->back = 0;
+    buffer->front = 1;
+    atomic_init(&buffer->middle, 2);
+}
+
+int TripleBufferGetBack(const TripleBuffer *buffer) {
+    return buffer->back;
+}
+
+void TripleBufferPublish(TripleBuffer *buffer) {
+    int previous = atomic_exchange_explicit(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH, memory_order_acq_rel);
+    buffer->back = previous & TRIPLE_BUFFER_SLOT;
+}
+
+int TripleBufferAcquire(TripleBuffer *buffer) {
+    if (atomic_load_explicit(&buffer->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH) {
+        int previous = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+        buffer->front = previous & TRIPLE_BUFFER_SLOT;
+    }
+
+    return buffer->front;
+}
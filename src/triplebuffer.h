@@ -0,0 +1,36 @@
+/**
+ * Lock free triple buffer handing the latest value from one writer thread to
+ * one reader thread.
+ *
+ * The caller owns three slots and this only tracks which slot is which: the
+ * writer fills its back slot and publishes it, the reader acquires the most
+ * recently published slot. Neither side ever waits, the writer may publish
+ * many times between two reads (only the last one is seen) and the reader
+ * keeps its slot until it acquires again, so it never sees a half written
+ * value.
+*/
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include "stdbool.h"
+#include "stdatomic.h"
+
+typedef struct TripleBuffer
+{
+    atomic_int middle;      // Last published slot, TRIPLE_BUFFER_FRESH set until the reader takes it
+    char middlePadding[60];
+    int back;               // Only touched by the writer
+    char backPadding[60];
+    int front;              // Only touched by the reader
+} TripleBuffer;
+
+void TripleBufferInit(TripleBuffer *buffer);
+
+// Writer side
+int TripleBufferGetBack(const TripleBuffer *buffer);
+void TripleBufferPublish(TripleBuffer *buffer);
+
+// Reader side, returns the slot to read, the newest published one if there is one
+int TripleBufferAcquire(TripleBuffer *buffer);
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Zobrist keys for hashing game states.
+ *
+ * Keys are derived from (kind, value) with a mixing function instead of a
+ * random table, so the windowed game and every SimState agree on them
+ * without sharing memory. The state hash is the XOR of the keys of the head
+ * cell, every cell covered by the body, every apple cell, the pending growth
+ * and the direction, and is updated by XOR when one of them changes.
+*/
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "stdint.h"
+
+typedef enum ZobristKind
+{
+    ZOBRIST_HEAD,
+    ZOBRIST_BODY,
+    ZOBRIST_APPLE,
+    ZOBRIST_DIRECTION,
+    ZOBRIST_GROWTH,
+} ZobristKind;
+
+static inline uint64_t ZobristKey(ZobristKind kind, int value) {
+    uint64_t x = (((uint64_t) kind << 32) | (uint32_t) value) * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL;
+
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+}
+
+// No growth hashes to 0 so a fresh state does not need a growth key
+static inline uint64_t ZobristGrowthKey(int pendingGrowth) {
+    return pendingGrowth > 0 ? ZobristKey(ZOBRIST_GROWTH, pendingGrowth) : 0;
+}
+
+// Direction -1 (not moving yet) has its own key
+static inline uint64_t ZobristDirectionKey(int direction) {
+    return ZobristKey(ZOBRIST_DIRECTION, direction + 1);
+}
+
+#endif